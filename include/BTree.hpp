@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DiskManager.hpp"
+#include "FileOps.hpp"
 #include "IndexMetaData.hpp"
 #include "IndexPageHandler.hpp"
 #include "Iouring.hpp"
@@ -35,8 +36,9 @@ struct BTree {
       undefined_btree {true}
   {};
   
-  BTree(IndexMetaData  index_meta_data,
-        FileDescriptor index_pages_filedescriptor);
+  /* the index data file stays open in the IndexManager, see IndexManager::index_files */
+  BTree(IndexMetaData index_meta_data,
+        const int32_t index_pages_filedescriptor);
   
   BTree(BTree&& other) noexcept            = default;
   BTree& operator=(BTree&& other) noexcept = default;
@@ -111,5 +113,5 @@ private:
   bool           undefined_btree;
   DiskManager*   disk_manager_ptr;
   IndexMetaData  meta_data;
-  FileDescriptor index_pages_fd;
+  int32_t        index_pages_fd = -1;
 };
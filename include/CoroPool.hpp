@@ -1,14 +1,22 @@
 #pragma once
 
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <coroutine>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <span>
 #include <stop_token>
 #include <thread>
+#include <vector>
 
-/* minus 1 because 1 thread is used to deal with IO tasks, see IoProcessor */
-const int32_t NUM_THREADS = 1;
+#include "Iouring.hpp"
+#include "Options.hpp"
 
 struct CoroPool { 
   CoroPool(const CoroPool&)            = delete;
@@ -61,20 +69,88 @@ struct CoroPool {
      You shouldn't call this method directly, unless you have a coroutine handle 
      you want to specfically schedule. */
   void enqueue(std::coroutine_handle<> coroutine) {
+    if (!shards.empty()) {
+      enqueue_shard({&coroutine, 1});
+      return;
+    }
+
     std::lock_guard<std::mutex> lock{queue_mutex};
     coro_queue.push(coroutine);
     cond_var.notify_one();
   }
 
+  /* enqueue for a whole batch of coroutines (the completions the IoProcessor reaped in
+     one pass), they are pushed under a single lock with a single notify */
+  void enqueue_batch(std::span<const std::coroutine_handle<>> coroutines) {
+    if (!shards.empty()) {
+      enqueue_shard(coroutines);
+      return;
+    }
+    
+    {
+      std::lock_guard<std::mutex> lock{queue_mutex};
+      for (const auto coroutine : coroutines)
+        coro_queue.push(coroutine);
+    }
+
+    if (coroutines.size() == 1) cond_var.notify_one();
+    else cond_var.notify_all();
+  }
+
 private:
+  /* In ring per thread mode (Options::ring_per_thread) every worker thread has its 
+     own Shard: a run queue and an io_uring ring that only it submits to and reaps.
+     Coroutines doing I/O on a shard are resumed by that shard's thread, other threads 
+     hand work to a shard by pushing onto its queue and waking its ring */
+  struct Shard {
+    std::unique_ptr<Iouring>             ring;
+    std::mutex                           queue_mutex;
+    std::queue<std::coroutine_handle<>>  coro_queue;
+    std::vector<std::coroutine_handle<>> completed;
+  };
+
+  /* Options::threads workers, the IoProcessor thread that deals with IO tasks is 
+     not one of them */
   CoroPool() {
-    for (int32_t thread; thread < NUM_THREADS; ++thread)
-      threads.emplace_back([&]() { thread_loop(); });
+    const int32_t num_threads = Options::get_instance().threads;
+    
+    if (!Options::get_instance().ring_per_thread) {
+      for (int32_t thread = 0; thread < num_threads; ++thread)
+        threads.emplace_back([this]() { thread_loop(); });
+      return;
+    }
+
+    for (int32_t shard = 0; shard < num_threads; ++shard) {
+      shards.push_back(std::make_unique<Shard>());
+      shards.back()->ring.reset(new Iouring{Iouring::RingOwner::Local});
+    }
+
+    for (int32_t shard = 0; shard < num_threads; ++shard)
+      threads.emplace_back([this, shard]() { shard_loop(shard); });
   }
 
   ~CoroPool() {
     stop_source.request_stop();
     cond_var.notify_all();
+
+    for (auto& shard : shards)
+      shard->ring->force_wake();
+  }
+
+  /* coroutines scheduled from a worker stay on that worker, anything coming from 
+     outside the pool is spread round robin over the shards (a batch at a time) */
+  void enqueue_shard(std::span<const std::coroutine_handle<>> coroutines) {
+    Shard& shard = local_shard ? *local_shard : 
+                                 *shards[next_shard++ % shards.size()];
+    {
+      std::lock_guard<std::mutex> lock{shard.queue_mutex};
+      for (const auto coroutine : coroutines)
+        shard.coro_queue.push(coroutine);
+    }
+
+    /* the shards own thread runs its queue before it goes to sleep */
+    if (&shard != local_shard)
+      shard.ring->wake();
   }
 
   /* The thread_loop function continuously waits for and 
@@ -103,10 +179,71 @@ private:
     }
   }
 
+  /* thread_loop for ring per thread mode, each pass the worker:
+     - runs every coroutine that was queued on its shard
+     - submits the SQEs those coroutines queued on its ring
+     - if it has nothing left to run, sleeps in the kernel until a completion arrives
+       or another thread wakes the ring after queueing work for it
+     - resumes the coroutines whose I/O completed, on this same thread */
+  void shard_loop(const int32_t shard_id) {
+    Shard&   shard = *shards[shard_id];
+    Iouring& ring  = *shard.ring;
+
+    local_shard         = &shard;
+    Iouring::local_ring = &ring;
+    bind_to_cpu(shard_id);
+
+    std::queue<std::coroutine_handle<>> ready;
+    ring.arm_wake();
+
+    while (!stop_source.stop_requested()) {
+      {
+        std::lock_guard<std::mutex> lock{shard.queue_mutex};
+        std::swap(ready, shard.coro_queue);
+      }
+      
+      for (; !ready.empty(); ready.pop())
+        ready.front().resume();
+
+      ring.submit_pending();
+      
+      bool is_idle;
+      {
+        std::lock_guard<std::mutex> lock{shard.queue_mutex};
+        is_idle = shard.coro_queue.empty();
+      }
+      if (is_idle) ring.wait_cqe();
+
+      ring.reap_completions(shard.completed);
+
+      for (const auto coroutine : shard.completed)
+        coroutine.resume();
+      shard.completed.clear();
+    }
+  }
+
+  static void bind_to_cpu(const int32_t shard_id) {
+    const uint32_t num_cpus = std::max(1u, std::thread::hardware_concurrency());
+    
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(shard_id % num_cpus, &cpu_set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
+      std::cerr << "Warning: could not bind worker " << shard_id << " to a cpu\n";
+  }
+
+  /* the shard the current thread owns, nullptr if not a ring per thread worker */
+  static inline thread_local Shard* local_shard = nullptr;
+
   std::stop_source        stop_source;
   std::mutex              queue_mutex;
   std::condition_variable cond_var;
   
-  std::vector<std::jthread>           threads;
-  std::queue<std::coroutine_handle<>> coro_queue;
+  std::queue<std::coroutine_handle<>>  coro_queue;
+  std::vector<std::unique_ptr<Shard>>  shards;
+  std::atomic<uint32_t>                next_shard = 0;
+  
+  /* declared last so the threads are joined before the state they use is destroyed */
+  std::vector<std::jthread>            threads;
 };
@@ -2,11 +2,13 @@
 
 #include <cstdlib>
 
+#include <chrono>
 #include <filesystem>
 #include <memory>
 #include <stdexcept>
 
 #include "FileDescriptor.hpp"
+#include "FileOps.hpp"
 #include "Parser.hpp"
 #include "SyncWaiter.hpp"
 #include "TableMetaData.hpp"
@@ -42,8 +44,8 @@ private:
   };
 
   Task<void> create_table(SQLStatement& sql_stmt);
-  void       drop_table  (const SQLStatement& sql_stmt);
-  void       load_table  (const std::string table_name);
+  Task<void> drop_table  (const SQLStatement& sql_stmt);
+  Task<void> load_table  (const std::string table_name);
   
   Task<std::vector<TableRecord>> table_query(SQLStatement& sql_stmt);
  
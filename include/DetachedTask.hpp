@@ -0,0 +1,38 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iostream>
+
+#include "CoroPool.hpp"
+#include "Task.hpp"
+
+/* A coroutine nobody waits on: it starts right away and its frame frees itself
+   when it finishes. Used for work that runs alongside the queries, like the
+   DiskManager's dirty page flusher, start one with spawn_detached */
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object()
+    { return {}; }
+
+    std::suspend_never initial_suspend()        { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+
+    void return_void() {}
+
+    /* spawn_detached catches everything, there is no one to hand an exception to */
+    void unhandled_exception()
+    { std::terminate(); }
+  };
+};
+
+/* runs task on the CoroPool without waiting for it, what it throws is printed */
+inline DetachedTask spawn_detached(Task<void> task) {
+  co_await CoroPool::get_instance().schedule();
+
+  try {
+    co_await task;
+  } catch (const std::exception& error) {
+    std::cerr << "Error: background task failed, " << error.what() << "\n";
+  }
+}
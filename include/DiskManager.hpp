@@ -6,135 +6,427 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <exception>
 #include <memory>
+#include <mutex>
 #include <span>
+#include <unordered_map>
 #include <vector>
 
+#include "CoroPool.hpp"
+#include "DetachedTask.hpp"
+#include "IoAwaitable.hpp"
 #include "IoProcessor.hpp"
 #include "Iouring.hpp"
+#include "PageArena.hpp"
+#include "PageTable.hpp"
+#include "Replacer.hpp"
 #include "Task.hpp"
 
 /********************************************************************************/
 
-struct IoAwaitable {
- /* this constructor is used for reads, where fd is the 
-    file we are reading from and offset is the offset into
-    the file */
-  IoAwaitable(const int32_t fd,
-              const off_t   offset,
-	      const IOP     iop) 
-  { 
-    sqe_data.fd	    = fd; 
-    sqe_data.iop    = iop;
-    sqe_data.offset = offset;
-  }
+/* most pages read_pages reads with a single readv */
+constexpr int32_t MAX_READ_RUN = 32;
 
-  /* this constructor is used for writes, where page_data 
-     is the data we want to write to the given fd */
-  IoAwaitable(const int32_t fd,
-              const off_t   offset,
-	      const IOP     iop, 
-	      Page*         page_data)
-    : IoAwaitable{fd, offset, iop} 
-  { 
-    sqe_data.page_data = page_data;
-  }
+/* pages read ahead the first time a file is seen being read sequentially */
+constexpr int32_t MIN_READAHEAD = 4;
 
-  /* pause the coroutine we are in right away */
-  bool await_ready() const 
-  { return false; }
-  
-  /* give SqeData a handle to the coroutine we have passed, we will
-     resume the coroutine when we handle the IO request */
-  void await_suspend(std::coroutine_handle<> coroutine) {
-    Iouring& io_uring  = Iouring::get_instance();
-    sqe_data.coroutine = coroutine;
+/* fewest frames a partition of the buffer pool gets, see DiskManager::bundles */
+constexpr int32_t MIN_BUNDLE_FRAMES = 8;
 
-    if (sqe_data.iop == IOP::Read)
-      io_uring.read_request(sqe_data);
-    else io_uring.write_request(sqe_data);
-  }
-  
-  int32_t await_resume() const 
-  { return sqe_data.buff_id; }
+/********************************************************************************/
 
-  SqeData sqe_data;
-};
+/* A partition of the buffer pool: the frames [first_frame, first_frame + size) with 
+   their own page table, replacer, free list and latch. A page can only be held by 
+   the bundle its (fd, page_num) hashes to (see DiskManager::bundle_for), so finding 
+   it, claiming a frame for it and picking a victim only touch that bundle and 
+   threads working on pages of different bundles don't contend. Frames (page_id) are 
+   numbered across the whole pool, the pages themselves live in the PageArena */
+struct PageBundle {
+  PageBundle(const int32_t         first,
+             const std::span<Page> arena_pages)
+    : first_frame  {first},
+      pages_used   (arena_pages.size()),
+      page_handlers(arena_pages.size()),
+      page_table   {arena_pages.size()},
+      replacer     {make_replacer(arena_pages.size())},
+      pages        {arena_pages}
+  {
+    /* handed out lowest frame first */
+    for (int32_t page_id = first + std::ssize(arena_pages) - 1; page_id >= first; --page_id)
+      free_frames.push_back(page_id);
+  };
 
-/********************************************************************************/
+  /* Admission queue of the bundle: a read or create that finds every frame of the 
+     bundle in use and nothing it can evict parks on this awaitable instead of reading
+     into a frame someone else owns. When a frame is released it is handed straight 
+     to the oldest waiter (it stays marked used) and that waiter is rescheduled on 
+     the CoroPool. When a frame turns evictable instead (its last pin is dropped, a 
+     read ahead page is mapped) the oldest waiter is woken with -1 and tries to evict
+     again (see frame_evictable). evictable_seen is get_evictable_gen() from before 
+     the caller last failed to evict, if a frame turned evictable since then the 
+     waiter doesn't park at all */
+  struct FrameAdmission {
+    FrameAdmission(PageBundle&    page_bundle,
+                   const uint32_t evictable_seen)
+      : bundle     {page_bundle},
+        seen_gen   {evictable_seen}
+    {};
 
-template<size_t N>
-using Bitset = std::array<bool, N>;
+    bool await_ready() { 
+      page_id = bundle.claim_frame();
+      return page_id != -1;
+    }
 
-template <size_t N>
-size_t find_first_false(const Bitset<N>& b_set) {
-  auto itr = std::find(std::begin(b_set), 
-		       std::end(b_set), false);
-  
-  if (itr != std::end(b_set))
-    return std::distance(std::begin(b_set), itr);
+    /* the claim is retried under the latch so a frame released between 
+       await_ready and now isn't missed, a frame that turned evictable is 
+       caught by either the waiter seeing the new generation or 
+       frame_evictable seeing the waiter */
+    bool await_suspend(std::coroutine_handle<> waiting_coroutine) {
+      std::lock_guard<std::mutex> lock{bundle.latch};
+      
+      if (!bundle.free_frames.empty()) {
+        page_id = bundle.take_free_frame();
+        return false;
+      }
 
-  return -1;
-}
+      ++bundle.num_waiters;
+      if (bundle.evictable_gen != seen_gen) {
+        --bundle.num_waiters;
+        return false;
+      }
 
-/********************************************************************************/
+      coroutine = waiting_coroutine;
+      bundle.frame_waiters.push_back(this);
+      return true;
+    }
+    
+    /* -1 if woken to evict again */
+    int32_t await_resume() const 
+    { return page_id; }
 
-struct BaseBundle {
-  virtual Page&	   get_page(const int32_t page_id)		    = 0;
-  virtual Handler& get_page_handler(const int32_t page_id)	    = 0; 
-  virtual bool     get_page_used(const int32_t page_id)             = 0;
-  virtual int32_t  get_min_page_usage()                             = 0;
-  virtual void	   set_page_used(const int32_t page_id, bool value) = 0;
-};
+    PageBundle&             bundle;
+    const uint32_t          seen_gen;
+    int32_t                 page_id = -1;
+    std::coroutine_handle<> coroutine;
+  };
 
-template <size_t N>
-struct PageBundle : BaseBundle {
-  Page& get_page(const int32_t page_id) override 
-  { return pages[page_id]; }
+  Page& get_page(const int32_t page_id) 
+  { return pages[page_id - first_frame]; }
 
-  Handler& get_page_handler(const int32_t page_id) override 
-  { return page_handlers[page_id]; }
+  Handler& get_page_handler(const int32_t page_id) 
+  { return page_handlers[page_id - first_frame]; }
   
-  bool get_page_used(const int32_t page_id) override 
-  { return pages_used[page_id]; }
+  bool get_page_used(const int32_t page_id) const
+  { return pages_used[page_id - first_frame]; }
+
+  int32_t get_num_frames() const
+  { return pages.size(); }
 
+  bool owns(const int32_t page_id) const
+  { return page_id >= first_frame && page_id < first_frame + get_num_frames(); }
+
+  /* frame holding the page, -1 if it isn't in the bundle */
   int32_t find_page(const int32_t page_fd, 
-                    const int32_t page_num)
+                    const int32_t page_num) const
+  { return page_table.find(page_fd, page_num); }
+
+  /* sets up the handler of a frame that was just read into, under the latch so 
+     try_pin never sees it half initialized. Only then is it mapped (map_page) */
+  Handler& init_frame(const int32_t      page_id,
+                      const RecordLayout layout,
+                      const int32_t      timestamp,
+                      const int32_t      page_num,
+                      const int32_t      page_fd)
   {
-    auto itr = std::find_if(std::begin(page_handlers), std::end(page_handlers),
-                            [page_fd, page_num] (const Handler& pg_h) {
-                              return pg_h.page_num == page_num &&
-                                     pg_h.page_fd  == page_fd; });
+    std::lock_guard<std::mutex> lock{latch};
+    Handler& pg_h = get_page_handler(page_id);
     
-    if (itr != std::end(page_handlers))
-      return std::distance(std::begin(page_handlers), itr);
+    pg_h.init_handler(&get_page(page_id), layout, timestamp, page_id, page_num, page_fd);
+    return pg_h;
+  }
+
+  /* adds the page the handler of page_id was initialized with to the page table,
+     returns the frame the page is mapped to, which is not page_id if another 
+     frame got the same page first */
+  int32_t map_page(const int32_t page_id) {
+    const Handler& pg_h = get_page_handler(page_id);
+    return page_table.insert(pg_h.page_fd, pg_h.page_num, page_id);
+  }
+
+  /* removes the page of page_id from the page table and forgets it in the handler,
+     call with the latch held */
+  void unmap_page(const int32_t page_id) {
+    Handler& pg_h = get_page_handler(page_id);
+    if (pg_h.page_fd != -1)
+      page_table.erase(pg_h.page_fd, pg_h.page_num, page_id);
     
-    return -1;
+    pg_h.page_fd  = -1;
+    pg_h.page_num = -1;
   }
-  
-  int32_t get_min_page_usage() override {
-    int32_t min_ref = INT32_MIN;
-    int32_t page_id = -1;
 
-    for (size_t i = 0 ; i < N; ++i)
-      if (!page_handlers[i].is_pinned && 
-          page_handlers[i].page_ref < min_ref) 
-      {
-	min_ref = page_handlers[i].page_ref;
-	page_id = i;
+  /* Pins and evictions meet under the latch: a page is only pinned while its frame 
+     still holds it and a frame is only unmapped while nobody has it pinned. So once 
+     try_pin succeeds the page stays in its frame until it is unpinned */
+  [[nodiscard]] bool try_pin(const int32_t page_id,
+                             const int32_t page_fd,
+                             const int32_t page_num) 
+  {
+    std::lock_guard<std::mutex> lock{latch};
+    Handler& pg_h = get_page_handler(page_id);
+    
+    if (!get_page_used(page_id) || pg_h.page_fd != page_fd || pg_h.page_num != page_num)
+      return false;
+    
+    pg_h.pin();
+    return true;
+  }
+
+  enum class UnmapResult { 
+    Unmapped, 
+    Kept,     /* pinned or dirtied again, the frame keeps the page */ 
+    Replaced  /* the frame holds another page by now, it isn't ours to free */
+  };
+
+  /* like try_pin but only pins a page nobody has pinned (0 -> 1), for writing a page 
+     back: a page that is pinned may be changed by its holder halfway through the 
+     write, it is written once they are done */
+  [[nodiscard]] bool try_pin_unpinned(const int32_t page_id,
+                                      const int32_t page_fd,
+                                      const int32_t page_num) 
+  {
+    std::lock_guard<std::mutex> lock{latch};
+    Handler& pg_h = get_page_handler(page_id);
+    
+    if (!get_page_used(page_id) || pg_h.page_fd != page_fd || pg_h.page_num != page_num)
+      return false;
+    
+    int32_t no_pins = 0;
+    return pg_h.pin_count.compare_exchange_strong(no_pins, 1);
+  }
+
+  /* like try_pin for a page known by the timestamp it was loaded with */
+  [[nodiscard]] bool try_pin(const int32_t page_id,
+                             const int32_t timestamp)
+  {
+    std::lock_guard<std::mutex> lock{latch};
+    Handler& pg_h = get_page_handler(page_id);
+    
+    if (!get_page_used(page_id) || pg_h.page_fd == -1 || pg_h.page_timestamp != timestamp)
+      return false;
+    
+    pg_h.pin();
+    return true;
+  }
+
+  /* unmaps the page of page_id if the frame still holds the page (page_fd, page_num,
+     timestamp) the caller started evicting and it is neither pinned nor dirty, a page 
+     is dirtied while pinned so a clean unpinned page has no changes that would be lost */
+  [[nodiscard]] UnmapResult unmap_unpinned(const int32_t page_id,
+                                           const int32_t page_fd,
+                                           const int32_t page_num,
+                                           const int32_t timestamp) 
+  {
+    std::lock_guard<std::mutex> lock{latch};
+    const Handler& pg_h = get_page_handler(page_id);
+    
+    if (!get_page_used(page_id) || pg_h.page_fd != page_fd || 
+        pg_h.page_num != page_num || pg_h.page_timestamp != timestamp)
+      return UnmapResult::Replaced;
+    
+    if (pg_h.is_pinned() || pg_h.is_dirty) return UnmapResult::Kept;
+    
+    unmap_page(page_id);
+    return UnmapResult::Unmapped;
+  }
+
+  /* unmaps the page of page_id if the frame holds a page of page_fd that is neither 
+     pinned nor taken by an evictor (the replacer still tracks it, it stops tracking 
+     it), its changes are thrown away. True if the frame is to be freed */
+  [[nodiscard]] bool unmap_dropped(const int32_t page_id,
+                                   const int32_t page_fd)
+  {
+    std::lock_guard<std::mutex> lock{latch};
+    Handler& pg_h = get_page_handler(page_id);
+    
+    if (!get_page_used(page_id) || pg_h.page_fd != page_fd || pg_h.is_pinned() ||
+        !replacer->remove(page_id - first_frame))
+      return false;
+    
+    pg_h.is_dirty = false;
+    unmap_page(page_id);
+    return true;
+  }
+
+  /* takes page_id for a ring to recycle: only while it still holds the page loaded 
+     with timestamp, is unpinned and the replacer still tracks it, it stops tracking 
+     it in the same step. A frame the replacer gave out as a victim belongs to that 
+     evictor, so a frame is only ever taken by one of them */
+  [[nodiscard]] bool take_tracked(const int32_t page_id,
+                                  const int32_t timestamp)
+  {
+    std::lock_guard<std::mutex> lock{latch};
+    const Handler& pg_h = get_page_handler(page_id);
+    
+    return get_page_used(page_id) && pg_h.page_fd != -1 && !pg_h.is_pinned() &&
+           pg_h.page_timestamp == timestamp && replacer->remove(page_id - first_frame);
+  }
+
+  /* takes a free frame without waiting, -1 if there is none */
+  [[nodiscard]] int32_t claim_frame() {
+    std::lock_guard<std::mutex> lock{latch};
+    return free_frames.empty() ? -1 : take_free_frame();
+  }
+
+  /* unmaps the frame and gives it to a parked coroutine if there is one, otherwise 
+     puts it back on the free list */
+  void release_frame(const int32_t page_id) {
+    FrameAdmission* waiter = nullptr;
+    {
+      std::lock_guard<std::mutex> lock{latch};
+      
+      /* forget which page the frame held, so find_page can't hand it out */
+      unmap_page(page_id);
+      if (frame_waiters.empty()) {
+        pages_used[page_id - first_frame] = false;
+        free_frames.push_back(page_id);
+        return;
       }
+
+      waiter = frame_waiters.front();
+      frame_waiters.pop_front();
+      --num_waiters;
+    }
+
+    waiter->page_id = page_id;
+    CoroPool::get_instance().enqueue(waiter->coroutine);
+  }
+
+  uint32_t get_evictable_gen() const 
+  { return evictable_gen; }
+
+  /* a frame of the bundle can be evicted now, the oldest waiter (if any) is woken 
+     to evict it. Cheap when nobody waits, the latch is only taken if someone does */
+  void frame_evictable() {
+    ++evictable_gen;
+    if (num_waiters == 0) return;
+
+    FrameAdmission* waiter = nullptr;
+    {
+      std::lock_guard<std::mutex> lock{latch};
+      if (frame_waiters.empty()) return;
+      
+      waiter = frame_waiters.front();
+      frame_waiters.pop_front();
+      --num_waiters;
+    }
+
+    waiter->page_id = -1;
+    CoroPool::get_instance().enqueue(waiter->coroutine);
+  }
+
+  /* the replacer works on the frames of the bundle counted from 0 */
+  void record_load(const int32_t page_id, 
+                   const bool    is_accessed)
+  { replacer->record_load(page_id - first_frame, is_accessed); }
   
+  void record_access(const int32_t page_id)
+  { replacer->record_access(page_id - first_frame); }
+  
+  void forget(const int32_t page_id)
+  { static_cast<void>(replacer->remove(page_id - first_frame)); }
+
+  /* frame the replacer picked to evict, it is used and not pinned, -1 if every 
+     frame is pinned */
+  [[nodiscard]] int32_t pick_victim() {
+    const int32_t victim = replacer->pick_victim([this](const int32_t frame) {
+      return pages_used[frame] && !page_handlers[frame].is_pinned();
+    });
+    
+    return (victim == NO_FRAME) ? NO_FRAME : victim + first_frame;
+  }
+  
+  const int32_t first_frame;
+
+private:
+  /* call with the latch held */
+  int32_t take_free_frame() {
+    const int32_t page_id = free_frames.back();
+    free_frames.pop_back();
+    
+    pages_used[page_id - first_frame] = true;
     return page_id;
   }
 
-  void set_page_used(const int32_t page_id, 
-                     bool value) override 
-  { pages_used[page_id] = value; }
+  std::vector<std::atomic<bool>> pages_used;
+  std::vector<Handler>           page_handlers;
+  PageTable                      page_table;
+  std::unique_ptr<Replacer>      replacer;
+  std::span<Page>                pages;
+
+  /* guards the free list, the parked coroutines, marking frames used, pinning 
+     against unmapping (try_pin, unmap_unpinned) and rings taking frames (take_tracked) */
+  std::mutex                  latch;
+  std::vector<int32_t>        free_frames;
+  std::deque<FrameAdmission*> frame_waiters;
+
+  /* bumped every time a frame turns evictable, num_waiters mirrors 
+     frame_waiters.size() so frame_evictable can skip the latch */
+  std::atomic<uint32_t>       evictable_gen = 0;
+  std::atomic<int32_t>        num_waiters   = 0;
+};
+
+/********************************************************************************/
+
+/* Buffer access strategy for bulk reads: a scan passes its ScanRing to read_page and
+   read_pages and the pages it misses are read into the frames of the ring. Once the
+   ring is full the frame of the page loaded a lap ago is reused, if that page is 
+   still there and unpinned, so a scan over a large table cycles through size() 
+   frames instead of evicting the hot pages of the pool. Frames of the ring stay 
+   ordinary pool frames, a ring only remembers which pages it loaded */
+struct ScanRing {
+  explicit ScanRing(const size_t num_frames)
+    : frames    (num_frames, NO_FRAME),
+      timestamps(num_frames, DEFAULT_TIMESTAMP)
+  {};
+
+  size_t size() const 
+  { return frames.size(); }
+
+private:
+  friend struct DiskManager;
   
-  Bitset<N>              pages_used;
-  std::array<Page, N>    pages;
-  std::array<Handler, N> page_handlers;
+  std::vector<int32_t> frames;     /* frame of every slot, NO_FRAME while empty */
+  std::vector<int32_t> timestamps; /* timestamp of the page the ring loaded in the frame */
+  size_t               next_slot = 0;
+};
+
+/********************************************************************************/
+
+/* pages [first_page, first_page + num_pages) to read ahead */
+struct ReadaheadWindow {
+  int32_t first_page = 0;
+  int32_t num_pages  = 0;
+};
+
+/* Readahead state of a file, see DiskManager::read_ahead */
+struct ReadaheadState {
+  /* the window to read ahead now that page_num is read, empty unless the file is 
+     being read sequentially and the reader got halfway into the last window. The 
+     window doubles up to max_window and never goes past file_pages, the pages 
+     the file uses. It is counted from the page after page_num, not from ahead_end, 
+     and the pages of it read ahead already are left out: the second readahead of a 
+     run ends 2 * MIN_READAHEAD pages past the reader but reads one page less */
+  ReadaheadWindow next_window(const int32_t page_num,
+                              const int32_t max_window,
+                              const int32_t file_pages);
+  
+  int32_t last_page = -1;
+  int32_t window    = 0; /* size of the last readahead */
+  int32_t ahead_end = 0; /* pages before this were read ahead already */
+  int32_t in_flight = 0; /* detached readaheads of the file still running */
 };
 
 /********************************************************************************/
@@ -150,37 +442,212 @@ struct DiskManager {
     return instance;
   }
 
+  /* stops the flusher, waiting for the pass it is in to finish, and waits 
+     for the readaheads in flight */
+  ~DiskManager();
+
+  /* The handlers create_page and read_page return are pinned once for the caller, 
+     who has to unpin them when done (RecordPageHandler and IndexPageHandler take 
+     over the pin and drop it when destroyed) */
+
+  /* a zeroed, dirty page that is written to disk when it is evicted or flushed,
+     waits for a frame like read_page */
   [[nodiscard]] Task<Handler*> create_page(const int32_t      fd,
                                            const int32_t      page_num,
                                            const RecordLayout layout);
+  /* throws std::runtime_error if the read failed, a page past the end of the file 
+     reads as zeros. When every frame is in use and none can be evicted the caller 
+     waits for one to be returned or to turn evictable, see FrameAdmission. With a 
+     ring a miss is read into a frame of the ring and there is no readahead, see 
+     ScanRing, otherwise readahead stops at file_pages, the pages fd uses */
   [[nodiscard]] Task<Handler*> read_page  (const int32_t      fd,
                                            const int32_t      page_num,
-                                           const RecordLayout layout);
+                                           const int32_t      file_pages,
+                                           const RecordLayout layout,
+                                           ScanRing*          ring = nullptr);
+
+  /* brings pages [first_page, first_page + num_pages) of fd into the buffer pool, 
+     each run of them that isn't in the pool already is read with one readv. Meant 
+     for sequential scans, the pages are then fetched with read_page as usual. When
+     there is no free frame it evicts one, if nothing can be evicted it stops */
+  Task<void> read_pages(const int32_t      fd,
+                        const int32_t      first_page,
+                        const int32_t      num_pages,
+                        const RecordLayout layout,
+                        const IoPriority   priority = IoPriority::Foreground,
+                        ScanRing*          ring     = nullptr);
+
+  /* Durability point for fd: writes every dirty page of fd that is in the pool, then 
+     fdatasyncs fd. The writes and the sync go out as linked chains (the last one ending 
+     in the Fsync), so this is a single round trip for up to MAX_LINKED - 1 pages. 
+     Returns 0 once everything is on disk, -errno if a write or the sync failed, the 
+     pages that were not written stay dirty. Pages pinned at the time are skipped, 
+     their holders may be changing them, they stay dirty for the next flush */
+  [[nodiscard]] Task<int32_t> flush_file(const int32_t fd);
+
+  /* drops every page of fd from the pool without writing it back, for a file that is
+     about to be removed. Has to be called before fd is closed, pages are keyed by fd 
+     and the next file opened may get the same fd. Waits for the readaheads of fd 
+     still running and forgets its readahead state. Pinned pages and pages an evictor 
+     is writing out are left alone, the file is expected to be unused by now */
+  Task<void> drop_file(const int32_t fd);
+
+  /* pins the page of pg_h again, a handler the caller kept from an earlier read_page
+     while the page was unpinned. The frame is checked to still hold the page loaded 
+     with timestamp under the latch, so the page can't be evicted in between. False 
+     if it was evicted, then it has to be read again */
+  [[nodiscard]] bool pin_again(Handler&      pg_h,
+                               const int32_t timestamp);
+
+  /* drops a pin of a page of the pool, once the last one is gone the frame can be 
+     evicted and a coroutine waiting for a frame of its bundle is woken */
+  void unpin_page(Handler& pg_h);
 
 private:
-  [[nodiscard]] int32_t lru_replacement(const PageType page_type);
+  /* the bundle the page (fd, page_num) belongs to, consecutive pages of a file 
+     are spread over the bundles */
+  PageBundle& bundle_for(const int32_t fd,
+                         const int32_t page_num)
+  { return *bundles[static_cast<uint32_t>(page_num + fd * 0x9E3779B1u) % bundles.size()]; }
+
+  /* the bundle frame page_id belongs to */
+  PageBundle& bundle_of(const int32_t page_id)
+  { return *bundles[std::min<size_t>(page_id / frames_per_bundle, bundles.size() - 1)]; }
+
+  int32_t get_num_frames() const
+  { return arena.pages().size(); }
+
+  /* a frame of bundle for a miss (from the ring with one, see take_ring_frame), 
+     parks on the bundles FrameAdmission until one is released or can be evicted */
+  Task<int32_t> acquire_frame(PageBundle& bundle,
+                              ScanRing*   ring);
+  
+  /* free frame of the bundle, evicting a page of the bundle if there is none, 
+     -1 if nothing could be evicted. priority is that of whoever needs the frame, 
+     a query waits for the eviction write so it goes out as Foreground */
+  Task<int32_t> claim_or_evict(PageBundle&      bundle,
+                               const IoPriority priority = IoPriority::Foreground);
+  
+  /* frame of bundle for the next page of a ring scan: the frame of the oldest slot 
+     of the ring that belongs to the bundle and can be recycled, otherwise a free or 
+     evicted frame of the bundle, -1 if there is none */
+  Task<int32_t> take_ring_frame(ScanRing&        ring,
+                                PageBundle&      bundle,
+                                const IoPriority priority = IoPriority::Foreground);
+  
+  /* records in the ring what was loaded into the frame take_ring_frame gave out, 
+     pg_h is the handler read_page returned, nullptr if the frame was released */
+  void keep_in_ring(ScanRing&      ring,
+                    const int32_t  page_id,
+                    const Handler* pg_h);
+  
+  /* like evict_page for a frame of a ring the caller took with take_tracked, the 
+     frame isn't freed, it stays used and belongs to the caller. False if the page 
+     was pinned or dirtied again (it is tracked again) or could not be written back */
+  Task<bool> recycle_frame(const int32_t    page_id,
+                           const IoPriority priority);
+
+  /* writes the victim (no longer tracked by the replacer, see pick_victim) back if 
+     it is dirty and frees its frame, unless it was pinned again in the meantime, 
+     then it is tracked again and keeps its page. Whether it still holds the page is 
+     checked against what it held before the write, see unmap_unpinned */
+  Task<void> evict_page(const int32_t    page_id,
+                        const IoPriority priority);
+  
+  /* forgets the frame in the replacer and releases it, see PageBundle::release_frame */
+  void free_frame(const int32_t page_id);
   
-  Task<void> write_page (const int32_t page_id,
-                         const int32_t page_num,
-                         PageType      page_type); 
-  Task<void> return_page(const int32_t  page_id,
-                         const PageType page_type);
+  Task<void> write_page(const int32_t    page_id,
+                        const int32_t    page_num,
+                        const IoPriority priority); 
   
-  [[nodiscard]] Handler* get_page(const int32_t  page_id,
-                                  const PageType page_type);
+  /* the pinned handler of page_id if it still holds (fd, page_num), nullptr if the 
+     page was evicted since it was found */
+  [[nodiscard]] Handler* get_page(const int32_t page_id,
+                                  const int32_t fd,
+                                  const int32_t page_num);
 
+  /* sets up the handler of a page that was just read in (or created) and maps it in 
+     the page table, returns the handler of the page (another frame if it was loaded 
+     twice) pinned. is_accessed is false for read ahead pages nobody has asked for 
+     yet, they are not pinned, nullptr if the page was already in another frame */
+  Handler* init_page(const int32_t      page_id,
+                     const int32_t      fd,
+                     const int32_t      page_num,
+                     const RecordLayout layout,
+                     const bool         is_accessed);
+
+  /* Background writeback, started by the constructor when Options::flush_interval_ms
+     is set. Sleeps flush_interval_ms between passes, each pass runs write_back, 
+     until flusher_stop is set */
+  Task<void> run_flusher();
+  
+  /* writes back the unpinned dirty pages that have been dirty for at least 
+     age_passes passes, then the oldest remaining ones while more than 
+     dirty_ratio percent of the pool is dirty */
+  Task<void> write_back(const uint32_t age_passes);
+
+  /* Sequential access detection for read_page: when page_num follows the last page
+     read from fd, the next window pages are read in the background (read_pages,
+     IoPriority::Background) without the caller waiting. The window doubles every 
+     time the reader gets halfway into what was read ahead, up to 
+     Options::readahead_pages, and is reset by a read that isn't sequential */
+  void read_ahead(const int32_t      fd,
+                  const int32_t      page_num,
+                  const int32_t      file_pages,
+                  const RecordLayout layout);
+
+  /* a detached readahead, counted in num_readaheads and the in_flight of its file */
+  Task<void> run_readahead(const int32_t      fd,
+                           const int32_t      first_page,
+                           const int32_t      num_pages,
+                           const RecordLayout layout);
+  
   DiskManager();
+  
   /* timstamp generator generates a timestamp associated with the page, 
      a user of the page can determine if their page has been reclaimed 
      by checking their timestamp */
-  int32_t     timestamp_gen;
-  IoProcessor io_processor;
+  std::atomic<int32_t> timestamp_gen;
+  IoProcessor          io_processor;
+
+  /* the frames of the pool are the pages of the arena, which is registered with 
+     io-uring as fixed buffers. The arena is cut into bundles of frames_per_bundle 
+     frames (the last one takes the rest), twice as many as there are worker threads
+     so they seldom latch the same one */
+  PageArena                                arena;
+  int32_t                                  frames_per_bundle;
+  std::vector<std::unique_ptr<PageBundle>> bundles;
+
+  /* passes of the flusher every frame has been seen dirty for, only the flusher uses them */
+  std::vector<uint32_t> dirty_ages;
+  std::atomic<bool>     flusher_stop = false;
+  std::atomic<bool>     flusher_done = true;
+
+  /* readahead state of every open file that has been read, see read_ahead */
+  std::mutex                                  readahead_mutex;
+  std::unordered_map<int32_t, ReadaheadState> readahead_states;
+  std::atomic<int32_t>                        num_readaheads = 0;
+};
+
+/********************************************************************************/
+
+/* RAII pin guard for pinning pages, with std::adopt_lock it takes over a pin that 
+   is already held (e.g. one from PageBundle::try_pin) */
+struct PinGuard {
+  PinGuard(Handler& page_handler)
+    : pg_h{page_handler}
+  { pg_h.pin(); }
+  
+  PinGuard(Handler& page_handler, std::adopt_lock_t)
+    : pg_h{page_handler}
+  {};
+
+  ~PinGuard() 
+  { DiskManager::get_instance().unpin_page(pg_h); }
 
-  /* io bundles are used only for IO as they are registered 
-     with io-uring */
-  PageBundle<BUFF_RING_SIZE>	     io_bundles;
-  PageBundle<PAGE_POOL_SIZE>	     np_bundles;
-  std::unique_ptr<io_uring_buf_ring> buff_ring_ptr; 
+  PinGuard(const PinGuard&)            = delete;
+  PinGuard& operator=(const PinGuard&) = delete;
   
-  std::array<BaseBundle*, PageType::NumPageTypes> bundles;
+  Handler& pg_h;
 };
@@ -4,16 +4,28 @@
 #include <unistd.h>
 #include <sys/stat.h>
 
+#include <cerrno>
 #include <cstdint>
 #include <filesystem>
 #include <iostream>
 #include <stdexcept>
 #include <utility>
 
+#include "Iouring.hpp"
+
 enum class OpenMode {
   Create, Default
 }; 
 
+/* Paged files have their pages read and written by the DiskManager through 
+   io_uring, so they are registered in the rings fixed file table for as long as
+   they are open, and opened with O_DIRECT when Options::direct_io is set (all their 
+   I/O is whole pages into page aligned frames). Meta files are only used for the 
+   small blocking reads and writes below */
+enum class FileUse {
+  Meta, Paged
+};
+
 struct FileDescriptor {
   FileDescriptor()
     : fd{-1} 
@@ -23,34 +35,45 @@ struct FileDescriptor {
   FileDescriptor& operator=(const FileDescriptor&) = delete;
   
   FileDescriptor(const std::string path, 
-                 const OpenMode open_mode = OpenMode::Default) 
+                 const OpenMode open_mode = OpenMode::Default,
+                 const FileUse  file_use  = FileUse::Meta) 
+    : FileDescriptor{open_file(path, open_mode, file_use), file_use}
+  {};
+
+  /* takes ownership of an fd that was opened elsewhere (see open_async) */
+  FileDescriptor(const int32_t open_fd,
+                 const FileUse file_use)
+    : fd{open_fd}
   {
-    fd = (open_mode == OpenMode::Default) ? open(path.c_str(), O_RDWR) : 
-                                            open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
-    if (fd == -1)
-      throw std::runtime_error("Error: Cannot open (or create) file:" + path + ", file may not exist");
+    if (file_use == FileUse::Paged) {
+      Iouring::register_file(fd);
+      is_fixed = true;
+    }
   };
 
   FileDescriptor(const std::filesystem::path path, 
-                 const OpenMode open_mode = OpenMode::Default)
-    : FileDescriptor{path.string(), open_mode} 
+                 const OpenMode open_mode = OpenMode::Default,
+                 const FileUse  file_use  = FileUse::Meta)
+    : FileDescriptor{path.string(), open_mode, file_use} 
   {};
 
   FileDescriptor(FileDescriptor&& other) 
-    : fd {std::exchange(other.fd, -1)} 
+    : fd      {std::exchange(other.fd, -1)},
+      is_fixed{std::exchange(other.is_fixed, false)}
   {};
   
   FileDescriptor& operator=(FileDescriptor&& other) {
     if (this == &other) return *this;
-    if (fd > 0 && close(fd) == -1) 
+    if (!close_fd()) 
       std::cerr << "Error: Cannot close file\n";
 
-    fd = std::exchange(other.fd, -1);
+    fd       = std::exchange(other.fd, -1);
+    is_fixed = std::exchange(other.is_fixed, false);
     return *this;
   }
 
   ~FileDescriptor() { 
-    if (fd > 0 && close(fd) == -1)
+    if (!close_fd())
       std::cerr << "Error: Cannot close file dtor()\n"; 
   }
   
@@ -80,5 +103,54 @@ struct FileDescriptor {
     return bytes_written;
   }
 
-  int32_t fd = -1;
+  /* writes at offset instead of the current file position */
+  ssize_t file_write(const void* buffer, size_t size, off_t offset) {
+    ssize_t bytes_written = pwrite(fd, buffer, size, offset);
+    if (bytes_written == -1)
+      throw std::runtime_error("Error: Failed to write to file");
+    
+    return bytes_written;
+  }
+
+  static int32_t open_file(const std::string path, 
+                           const OpenMode    open_mode, 
+                           const FileUse     file_use) 
+  {
+    const int32_t flags = open_flags(open_mode, file_use);
+    int32_t open_fd     = open(path.c_str(), flags, 0666);
+    
+    /* the filesystem doesn't do direct I/O (tmpfs for one), go through the page cache */
+    if (open_fd == -1 && errno == EINVAL && (flags & O_DIRECT)) {
+      std::cerr << "Warning: O_DIRECT not supported for " << path << "\n";
+      open_fd = open(path.c_str(), flags & ~O_DIRECT, 0666);
+    }
+
+    if (open_fd == -1)
+      throw std::runtime_error("Error: Cannot open (or create) file:" + path + ", file may not exist");
+    
+    return open_fd;
+  }
+
+  static int32_t open_flags(const OpenMode open_mode, 
+                            const FileUse  file_use) 
+  {
+    int32_t flags = (open_mode == OpenMode::Default) ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC;
+    if (file_use == FileUse::Paged && Options::get_instance().direct_io)
+      flags |= O_DIRECT;
+    
+    return flags;
+  }
+
+  int32_t fd       = -1;
+  bool    is_fixed = false;
+
+private:
+  /* the fd has to leave the fixed file tables before it is closed, 
+     otherwise a new file could get the same fd and slot */
+  bool close_fd() {
+    if (fd <= 0) return true;
+    
+    if (is_fixed) Iouring::unregister_file(fd);
+    return close(fd) != -1;
+  }
 };
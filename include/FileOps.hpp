@@ -0,0 +1,44 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "FileDescriptor.hpp"
+#include "IoAwaitable.hpp"
+#include "Task.hpp"
+
+/* File lifecycle done through io_uring (OPENAT, MKDIRAT, UNLINKAT, CLOSE) so that
+   creating and dropping tables and indexes doesn't block the CoroPool thread the 
+   statement runs on. Errors are thrown as std::runtime_error like FileDescriptor */
+
+/* opens (or creates, truncating) path, Paged files are registered as fixed files */
+Task<FileDescriptor> open_async(const std::filesystem::path path,
+                                const OpenMode              open_mode = OpenMode::Default,
+                                const FileUse               file_use  = FileUse::Meta);
+
+/* unregisters and closes the file, file is left holding no fd */
+Task<void> close_async(FileDescriptor file);
+
+/* creates an empty file at path, or truncates the one that is there */
+Task<void> create_file_async(const std::filesystem::path path);
+
+/* like std::filesystem::create_directories, existing directories are fine */
+Task<void> create_directories_async(const std::filesystem::path path);
+
+/* like std::filesystem::remove_all, a path that doesn't exist is fine */
+Task<void> remove_all_async(const std::filesystem::path path);
+
+/* makes sure pages [0, num_pages) of fd have disk blocks behind them, the file is grown 
+   past allocated_pages a whole extent (Options::extent_mb) at a time. Returns how many 
+   pages are allocated now, allocated_pages if preallocation is off or the filesystem 
+   doesn't support it (the file then grows as pages are written, like before) */
+Task<int32_t> preallocate_async(const int32_t fd,
+                                const int32_t num_pages,
+                                const int32_t allocated_pages);
@@ -4,10 +4,12 @@
 #include <filesystem>
 #include <span>
 #include <sstream>
+#include <unordered_map>
 
 #include "BTree.hpp"
 #include "DiskManager.hpp"
 #include "FileDescriptor.hpp"
+#include "FileOps.hpp"
 #include "IndexMetaData.hpp"
 #include "Iouring.hpp"
 #include "TableRecord.hpp"
@@ -20,6 +22,10 @@ static constexpr bool    DELETE_FROM_TREE = false;
 struct IndexManager {
   IndexManager(std::filesystem::path index_folder_path);
 
+  /* opens the catalog with open_async, creating it for a new table, has to be 
+     awaited before anything else is done with the IndexManager */
+  Task<void> open_catalog();
+
   /* create a new index */
   Task<PageResponse> create_index(const std::span<std::string> new_index, 
                                   const int32_t                num_attr,
@@ -33,7 +39,7 @@ struct IndexManager {
 
   /* get a BTree when given an index, not recommended unless you know 
      index exists */
-  BTree get_index(const int32_t index_id) 
+  Task<BTree> get_index(const int32_t index_id) 
   { return get_btree(index_id); }
   
   Task<int32_t> find_index(const std::span<std::string> attr_list,
@@ -53,12 +59,16 @@ struct IndexManager {
                                  const RecId rec_id) 
   { co_await update_trees(table_record, rec_id, DELETE_FROM_TREE); }
 
+  /* the index files are about to be removed, their pages are dropped from the buffer 
+     pool without being written (see DiskManager::drop_file) */
+  Task<void> drop_pages();
+
 private:
   Task<void>    update_trees(const TableRecord& table_record,
                              const RecId        rec_id,
                              const bool         is_insert);
-  BTree         get_btree(const int32_t index_num);
-  Task<void>    init_index_folder(const std::string   new_index_name,
+  Task<BTree>   get_btree(const int32_t index_num);
+  Task<void>    init_index_folder(const int32_t       index_num,
                                   const RecordLayout& index_layout);
   
   void read_header() {
@@ -77,10 +87,17 @@ private:
                 sizeof(num_index));
   }
 
-  Task<void> load_catalog() {
+  /* the catalog is only pinned while it is used: pins it for the caller, who takes 
+     the pin over with a PinGuard (std::adopt_lock), reading it again if it was 
+     evicted since it was last used */
+  Task<void> pin_catalog() {
+    if (handler_ptr && DiskManager::get_instance().pin_again(*handler_ptr, page_timestamp))
+      co_return;
+
     bool should_read_header = (handler_ptr == nullptr);
     handler_ptr = co_await DiskManager::get_instance().read_page(catalog_file.fd, 
                                                                  0, 
+                                                                 1,
                                                                  RecordLayout{});
     page_timestamp = handler_ptr->page_timestamp;
     if (should_read_header) read_header();
@@ -92,4 +109,9 @@ private:
   Handler*              handler_ptr;
   FileDescriptor        catalog_file;
   std::filesystem::path parent_index_folder;
+
+  /* INDEX_DATA of every index used so far, kept open for as long as we are: pages in 
+     the buffer pool are keyed by fd, a closed fd can be handed to another file while 
+     pages of the index are still in the pool under it */
+  std::unordered_map<int32_t, FileDescriptor> index_files;
 };
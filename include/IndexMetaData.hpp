@@ -1,9 +1,17 @@
 #pragma once
 
 #include <cstring>
+#include <exception>
+#include <iostream>
+#include <sys/uio.h>
+
+#include <span>
+#include <vector>
 
 #include "FileDescriptor.hpp"
+#include "IoAwaitable.hpp"
 #include "Iouring.hpp"
+#include "Task.hpp"
 #include "Util.hpp"
 
 
@@ -120,6 +128,7 @@ constexpr int32_t EMPTY_INDEX = -1;
 struct IndexMetaData {
   IndexMetaData()
     : num_pages     {EMPTY_INDEX},
+      num_allocated {0},
       root_page     {EMPTY_INDEX},
       first_free_pg {NO_FREE_PAGE},
       first_leaf    {EMPTY_INDEX},
@@ -127,12 +136,12 @@ struct IndexMetaData {
       key_size      {calc_record_size(key_layout)}
   {};
 
-  IndexMetaData(RecordLayout key,
-                const std::string data_file) 
+  /* a new index, meta_data_file_fd is the freshly created meta data file */
+  IndexMetaData(RecordLayout   key,
+                FileDescriptor meta_data_file_fd) 
     : IndexMetaData{} 
   {
-    key_layout     = key;
-    meta_data_file = data_file;
+    key_layout = key;
 
     btree_order = (PAGE_SIZE - sizeof(IndexPageHdr)) / (key_size + sizeof(RecId));
     assert(btree_order > 2);
@@ -140,21 +149,30 @@ struct IndexMetaData {
     num_key_attr = key_layout.size();
     key_offset   = sizeof(IndexPageHdr);
     rid_offset   = key_offset + key_size * btree_order;
-    write_meta_data();
+    meta_data_fd = std::move(meta_data_file_fd);
+    is_dirty     = true;
   };
 
-  IndexMetaData(RecordLayout key,
-                const std::filesystem::path path)
-    : IndexMetaData{key, path.string()}
-  {};
-
-  IndexMetaData(const std::string data_file)
-    : meta_data_file{data_file} 
+  /* an existing index, meta_data_file_fd is its opened meta data file */
+  IndexMetaData(FileDescriptor meta_data_file_fd)
+    : meta_data_fd{std::move(meta_data_file_fd)}
   { read_meta_data(); };
 
-  IndexMetaData(const std::filesystem::path data_file)
-    : meta_data_file{data_file.string()} 
-  { read_meta_data(); };
+  /* owns the meta data file, so it can only be moved */
+  IndexMetaData(IndexMetaData&&)            = default;
+  IndexMetaData& operator=(IndexMetaData&&) = default;
+
+  /* last chance for changes that were never flushed, this write blocks */
+  ~IndexMetaData() {
+    if (!is_dirty || meta_data_fd.fd == -1) return;
+    
+    try {
+      const std::vector<uint8_t> buffer = serialize();
+      meta_data_fd.file_write(buffer.data(), buffer.size(), 0);
+    } catch (const std::exception& error) {
+      std::cerr << "Error: Cannot write index meta data dtor(), " << error.what() << "\n";
+    }
+  }
   
   const int32_t get_order() const 
   { return btree_order; }
@@ -189,39 +207,68 @@ struct IndexMetaData {
   const RecordLayout& get_key_layout() const
   { return key_layout; }
  
-  void increase_num_pages() { ++num_pages; }
-  void decrease_num_pages() { --num_pages; }
+  void increase_num_pages() { ++num_pages; is_dirty = true; }
+  void decrease_num_pages() { --num_pages; is_dirty = true; }
+
+  /* pages preallocated in the index file, num_pages of them are in use */
+  const int32_t get_num_allocated() const
+  { return num_allocated; }
+
+  void set_num_allocated(const int32_t allocated_pages) 
+  { num_allocated = allocated_pages; is_dirty = true; }
   
   void set_first_free_page(int32_t free_page)
-  { first_free_pg = free_page; }
+  { first_free_pg = free_page; is_dirty = true; }
   
   void set_root_page(int32_t new_root_page)
-  { root_page = new_root_page; }
+  { root_page = new_root_page; is_dirty = true; }
 
   void set_last_leaf(int32_t new_last_leaf)
-  { last_leaf = new_last_leaf; }
+  { last_leaf = new_last_leaf; is_dirty = true; }
+
+  /* Writes the meta data out with a single io_uring write if it changed since the last 
+     flush. The setters only mark it dirty, so all the root/leaf/free page changes of 
+     one BTree operation are written together when the operation ends */
+  Task<void> flush() {
+    if (!is_dirty) co_return;
+    is_dirty = false;
+    
+    std::vector<uint8_t> buffer = serialize();
+    iovec io_vec {buffer.data(), buffer.size()};
+      
+    const int32_t bytes_written = co_await IoAwaitable{meta_data_fd.fd, 
+                                                       0, 
+                                                       std::span{&io_vec, 1}, 
+                                                       IOP::Write};
+    /* leave it dirty, the next flush (or the destructor) tries again */
+    if (bytes_written != std::ssize(buffer))
+      is_dirty = true;
+  }
 
 private:
-  void write_meta_data() {
-    FileDescriptor out{meta_data_file};
-
-    out.file_write(&btree_order  , sizeof(btree_order));
-    out.file_write(&num_pages    , sizeof(num_pages));
-    out.file_write(&root_page    , sizeof(root_page));
-    out.file_write(&first_free_pg, sizeof(first_free_pg));
-    out.file_write(&first_leaf   , sizeof(first_leaf));
-    out.file_write(&last_leaf    , sizeof(last_leaf));
-    out.file_write(&key_size     , sizeof(key_size));
-    out.file_write(&num_key_attr , sizeof(num_key_attr));
-    out.file_write(&key_offset   , sizeof(key_offset));
-    out.file_write(&rid_offset   , sizeof(rid_offset));
+  std::vector<uint8_t> serialize() const {
+    std::vector<uint8_t> buffer;
+
+    append_bytes(buffer, &btree_order  , sizeof(btree_order));
+    append_bytes(buffer, &num_pages    , sizeof(num_pages));
+    append_bytes(buffer, &root_page    , sizeof(root_page));
+    append_bytes(buffer, &first_free_pg, sizeof(first_free_pg));
+    append_bytes(buffer, &first_leaf   , sizeof(first_leaf));
+    append_bytes(buffer, &last_leaf    , sizeof(last_leaf));
+    append_bytes(buffer, &key_size     , sizeof(key_size));
+    append_bytes(buffer, &num_key_attr , sizeof(num_key_attr));
+    append_bytes(buffer, &key_offset   , sizeof(key_offset));
+    append_bytes(buffer, &rid_offset   , sizeof(rid_offset));
 
     for (int32_t i = 0; i < num_key_attr; ++i)
-      out.file_write(&key_layout[i], sizeof(DatabaseType));
+      append_bytes(buffer, &key_layout[i], sizeof(DatabaseType));
+
+    append_bytes(buffer, &num_allocated, sizeof(num_allocated));
+    return buffer;
   }
 
   void read_meta_data() {
-    FileDescriptor in{meta_data_file};
+    FileDescriptor& in = meta_data_fd;
     
     in.file_read(&btree_order  , sizeof(btree_order));
     in.file_read(&num_pages    , sizeof(num_pages));
@@ -239,10 +286,15 @@ private:
       in.file_read(&db_type, sizeof(db_type));
       key_layout.push_back(db_type);
     }
+
+    /* written before extents existed, nothing was preallocated */
+    if (in.file_read(&num_allocated, sizeof(num_allocated)) != sizeof(num_allocated))
+      num_allocated = 0;
   }
 
   int32_t btree_order; 
   int32_t num_pages;
+  int32_t num_allocated;
   int32_t root_page;
   int32_t first_free_pg;
   int32_t first_leaf;
@@ -252,6 +304,9 @@ private:
   int32_t key_offset;
   int32_t rid_offset;
 
-  std::string  meta_data_file;
-  RecordLayout key_layout;
+  FileDescriptor meta_data_fd;
+  RecordLayout   key_layout;
+  
+  /* a BTree (and its meta data) is only used by one coroutine at a time */
+  bool is_dirty = false;
 };
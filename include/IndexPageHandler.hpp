@@ -1,5 +1,7 @@
 #pragma once 
 
+#include <utility>
+
 #include "IndexMetaData.hpp"
 #include "Iouring.hpp"
 #include "Util.hpp"
@@ -9,11 +11,17 @@ struct IndexPageHandler {
     : handler_ptr{nullptr}, 
       meta_data_ptr{nullptr} {};
   
+  /* takes over the pin of a handler from DiskManager::read_page or create_page */
   IndexPageHandler(Handler* handler, 
                    const IndexMetaData* index_meta_data);
   
   ~IndexPageHandler();
 
+  /* a copy pins the page again, a moved from handler no longer holds it */
+  IndexPageHandler(const IndexPageHandler& other);
+  IndexPageHandler(IndexPageHandler&& other) noexcept;
+  IndexPageHandler& operator=(IndexPageHandler other) noexcept;
+
   /* returns first value that is greater than or equal to key_value */
   int32_t lower_bound(const Record key_value);
   
@@ -116,45 +124,53 @@ struct IndexPageHandler {
   { return page_hdr.is_leaf; }
  
   void set_page_header(const IndexPageHdr new_header) {
-    handler_ptr->is_dirty = true;
+    mark_modified();
     page_hdr = new_header;
   }
 
   void set_parent(int32_t new_parent) { 
-    handler_ptr->is_dirty = true;
+    mark_modified();
     page_hdr.parent = new_parent; 
   }
   
   void set_num_keys(int32_t new_num_keys) { 
-    handler_ptr->is_dirty = true;
+    mark_modified();
     page_hdr.num_keys = new_num_keys; 
   }
   
   void set_num_children(int32_t new_num_children) { 
-    handler_ptr->is_dirty = true;
+    mark_modified();
     page_hdr.num_children = new_num_children; 
   }
   
   void set_next_free(int32_t new_next_free) { 
-    handler_ptr->is_dirty = true;
+    mark_modified();
     page_hdr.next_free = new_next_free; 
   }
   
   void set_prev_leaf(int32_t new_prev_leaf) { 
-    handler_ptr->is_dirty = true;
+    mark_modified();
     page_hdr.prev_leaf = new_prev_leaf; 
   }
 
   void set_next_leaf(int32_t new_next_leaf) { 
-    handler_ptr->is_dirty = true;
+    mark_modified();
     page_hdr.next_leaf = new_next_leaf; 
   }
 
   void set_is_leaf(bool new_is_leaf) { 
-    handler_ptr->is_dirty = true;
+    mark_modified();
     page_hdr.is_leaf = new_is_leaf; 
   }
 
+  /* the page was changed through us, the header is written back and the page 
+     marked dirty when we release it. Kept apart from the shared dirty bit, which 
+     the flusher clears when it writes the page out while we still hold it */
+  void mark_modified() {
+    is_modified           = true;
+    handler_ptr->is_dirty = true;
+  }
+
   /* directly updating the page_hdr doesn't make the 
      page dirty, so updates may not be reflected, 
      use setters */
@@ -203,5 +219,6 @@ private:
   const IndexMetaData* meta_data_ptr; 
   int32_t              timestamp;
   RecordLayout         key_layout;
+  bool                 is_modified = false;
 };
 
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <span>
+#include <vector>
+
+#include "Iouring.hpp"
+#include "Task.hpp"
+
+/********************************************************************************/
+
+struct IoAwaitable {
+ /* this constructor is used for reads, where fd is the 
+    file we are reading from and offset is the offset into
+    the file */
+  IoAwaitable(const int32_t fd,
+              const off_t   offset,
+	      const IOP     iop) 
+  { 
+    sqe_data.fd	    = fd; 
+    sqe_data.iop    = iop;
+    sqe_data.offset = offset;
+  }
+
+  /* page_data is the page we want to write to the given fd, 
+     or the page we want to read into */
+  IoAwaitable(const int32_t    fd,
+              const off_t      offset,
+	      const IOP        iop, 
+	      Page*            page_data,
+              const IoPriority priority = IoPriority::Foreground)
+    : IoAwaitable{fd, offset, iop} 
+  { 
+    sqe_data.page_data = page_data;
+    sqe_data.priority  = priority;
+  }
+
+  /* vectored read (or write), fills the buffers iovecs point to with consecutive 
+     bytes of fd starting at offset */
+  IoAwaitable(const int32_t     fd,
+              const off_t       offset,
+              std::span<iovec>  iovecs,
+              const IOP         iop      = IOP::Read,
+              const IoPriority  priority = IoPriority::Foreground)
+    : IoAwaitable{fd, offset, iop} 
+  { 
+    sqe_data.iovecs     = iovecs.data();
+    sqe_data.num_iovecs = iovecs.size();
+    sqe_data.priority   = priority;
+  }
+
+  /* file lifecycle request on path (OpenAt, MkdirAt, UnlinkAt), for Close use 
+     the fd constructor above */
+  IoAwaitable(const IOP     iop,
+              const char*   path,
+              const int32_t flags,
+              const mode_t  mode = 0)
+  {
+    sqe_data.iop   = iop;
+    sqe_data.path  = path;
+    sqe_data.flags = flags;
+    sqe_data.mode  = mode;
+  }
+
+  /* Timeout, resumes the coroutine once duration has passed without holding 
+     up a thread, see sleep_for */
+  IoAwaitable(const std::chrono::nanoseconds duration)
+  {
+    sqe_data.iop             = IOP::Timeout;
+    sqe_data.timeout.tv_sec  = duration.count() / 1'000'000'000;
+    sqe_data.timeout.tv_nsec = duration.count() % 1'000'000'000;
+  }
+
+  /* pause the coroutine we are in right away */
+  bool await_ready() const 
+  { return false; }
+  
+  /* give SqeData a handle to the coroutine we have passed, we will
+     resume the coroutine when we handle the IO request. If the Task awaiting 
+     has a deadline a read is linked to a timeout that cancels it (-ECANCELED) 
+     when the deadline passes, a read past its deadline isn't submitted at all 
+     (-ETIME). Writes carry data that has to land whatever the query, so they 
+     are never timed out */
+  template <typename Promise>
+  bool await_suspend(std::coroutine_handle<Promise> coroutine) {
+    Iouring& io_uring  = Iouring::get_instance();
+    sqe_data.coroutine = coroutine;
+
+    if (const Deadline deadline = deadline_of(coroutine);
+        deadline != NO_DEADLINE && sqe_data.iop == IOP::Read)
+    {
+      const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               deadline - std::chrono::steady_clock::now());
+      if (remaining.count() <= 0) {
+        sqe_data.status_code = -ETIME;
+        return false;
+      }
+
+      sqe_data.has_timeout     = true;
+      sqe_data.timeout.tv_sec  = remaining.count() / 1'000'000'000;
+      sqe_data.timeout.tv_nsec = remaining.count() % 1'000'000'000;
+    }
+
+    switch (sqe_data.iop) {
+      case IOP::Read : io_uring.read_request(sqe_data);  break;
+      case IOP::Write: io_uring.write_request(sqe_data); break;
+      default:         io_uring.file_request(sqe_data);
+    }
+    return true;
+  }
+  
+  /* result of the request, bytes transferred (the new fd for OpenAt) or -errno, 
+     see is_deadline_error */
+  int32_t await_resume() const 
+  { return sqe_data.status_code; }
+
+  /* the request was not done because the deadline of the query passed */
+  static bool is_deadline_error(const int32_t status_code) 
+  { return status_code == -ECANCELED || status_code == -ETIME; }
+
+  SqeData sqe_data;
+};
+
+[[nodiscard]] inline IoAwaitable sleep_for(const std::chrono::nanoseconds duration)
+{ return IoAwaitable{duration}; }
+
+/********************************************************************************/
+
+/* Submits a chain of requests linked with IOSQE_IO_LINK (see Iouring::linked_request) 
+   and resumes the coroutine once every one of them has completed, e.g. page writes 
+   followed by an Fsync give a durability point in one round trip. The requests are 
+   filled in with the SqeData fields and iop like an IoAwaitable */
+struct LinkedIoAwaitable {
+  LinkedIoAwaitable(std::vector<SqeData> requests)
+    : chain{std::move(requests)}
+  {};
+  
+  /* nothing to wait on */
+  bool await_ready() const 
+  { return chain.empty(); }
+
+  void await_suspend(std::coroutine_handle<> coroutine) {
+    num_pending = chain.size();
+    
+    for (SqeData& sqe_data : chain) {
+      sqe_data.coroutine   = coroutine;
+      sqe_data.num_pending = &num_pending;
+    }
+    Iouring::get_instance().linked_request(chain);
+  }
+
+  /* status of the first request that failed, 0 if they all succeeded */
+  int32_t await_resume() const {
+    auto failed = std::find_if(std::begin(chain), std::end(chain), 
+                               [](const SqeData& sqe_data) {
+                                 return sqe_data.status_code < 0; });
+    
+    return (failed == std::end(chain)) ? 0 : failed->status_code;
+  }
+
+  std::vector<SqeData> chain;
+  std::atomic<int32_t> num_pending = 0;
+};
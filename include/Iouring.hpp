@@ -1,19 +1,31 @@
 #pragma once
 
+#include "Options.hpp"
 #include "Util.hpp"
 
 #include <cassert>
 #include <cstdint>
+#include <fcntl.h>
 #include <liburing.h>
 #include <liburing/io_uring.h>
+#include <linux/ioprio.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <coroutine>
 #include <cstring>
+#include <deque>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <stdexcept>
 #include <span>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 /********************************************************************************/
@@ -23,9 +35,25 @@
 enum class IOP {
   Read, 
   Write, 
+  Fsync,
+  Fallocate,
+  OpenAt,
+  MkdirAt,
+  UnlinkAt,
+  Close,
+  Timeout,
   NullOp
 };
 
+/* Foreground requests are the ones a query is waiting on, Background ones are bulk 
+   work like eviction writeback. The class goes into the SQEs ioprio (honoured by the 
+   bfq and mq-deadline schedulers) and each ring caps how many background requests it 
+   has in flight, so they can't pile up ahead of foreground reads */
+enum class IoPriority {
+  Foreground,
+  Background
+};
+
 enum class PageResponse {
   PageFull,
   PageEmpty,
@@ -39,38 +67,23 @@ enum class PageResponse {
   Success
 };
 
+/* Lock: read the page optimistically, validating against its version, DontLock: the 
+   caller is the writer of the page and already has it (see Handler::begin_write) */
 enum class LockOpt { 
   Lock, 
   DontLock
 };
 
-enum PageType {
-  IO, 
-  NonPersistent, 
-  NumPageTypes 
-};
-
 constexpr int32_t PAGE_SIZE         = 4096; 
 constexpr int32_t DEFAULT_TIMESTAMP = -1;
 using Page = std::array<uint8_t, PAGE_SIZE>;
 
-/* RAII pin guard for pinning pages */
-struct PinGuard {
-  PinGuard(std::atomic<bool>& page_pin)
-    : pin{page_pin} 
-  { pin = true; }
-
-  ~PinGuard() 
-  { pin = false; }
-  
-  std::atomic<bool>& pin;
-};
-
 /********************************************************************************/
 /* Handler struct: This struct is what is returned from a call to create or read page 
    in the DiskManager, it is a handler to a page meaning it provides some utility functions
    that make reading and writing records to the page simpler. Addtionally it contains 
-   atomics which hold whether the page is dirty and whether the page is pinned or not */
+   atomics which hold whether the page is dirty and how many holders have it pinned, 
+   a page is only evicted once nobody has it pinned */
 struct Handler {
   Handler() = default;
   void init_handler(Page*              page,
@@ -78,8 +91,7 @@ struct Handler {
                     const int32_t      timestamp,
                     const int32_t      pg_id,
                     const int32_t      pg_num,
-                    const int32_t      pg_fd,
-                    const PageType     pg_type)
+                    const int32_t      pg_fd)
   {
 	assert(page);
 	page_ptr       = page;
@@ -88,12 +100,57 @@ struct Handler {
 	page_id        = pg_id;
 	page_num       = pg_num;
 	page_fd        = pg_fd;
-	page_type      = pg_type;
-	page_usage     = 1;
-	page_ref       = 1;
 	is_dirty       = false;
-	is_pinned      = false;
   }
+
+  /* every pin has to be matched by an unpin, a page handed out by the DiskManager
+     comes pinned once for the caller. Pages of the buffer pool are unpinned through
+     DiskManager::unpin_page, which wakes whoever waits for the frame to free up, 
+     unpin is true if it dropped the last pin */
+  void pin() 
+  { pin_count.fetch_add(1); }
+  
+  bool unpin() { 
+	const int32_t pins = pin_count.fetch_sub(1);
+	assert(pins > 0);
+	return pins == 1;
+  }
+  
+  bool is_pinned() const 
+  { return pin_count.load() > 0; }
+
+  /* Per frame seqlock over the page bytes: version is even while the page is stable 
+     and odd while a writer is changing it. Readers take no latch, they remember the 
+     version (read_begin), copy what they need and retry if read_validate says a 
+     writer got in between. Writers are serialized by begin_write and make the 
+     version even again in end_write, keep their sections short (no co_await) */
+  uint32_t read_begin() const {
+	uint32_t ver;
+	while ((ver = version.load(std::memory_order_acquire)) & 1)
+	  std::this_thread::yield();
+	return ver;
+  }
+
+  bool read_validate(const uint32_t ver) const {
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return version.load(std::memory_order_relaxed) == ver;
+  }
+
+  void begin_write() {
+	uint32_t ver = version.load(std::memory_order_relaxed);
+	while ((ver & 1) || 
+	       !version.compare_exchange_weak(ver, ver + 1, std::memory_order_acquire))
+	{
+	  if (ver & 1) {
+		std::this_thread::yield();
+		ver = version.load(std::memory_order_relaxed);
+	  }
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void end_write() 
+  { version.fetch_add(1, std::memory_order_release); }
  
   /* ensure you have dealt with conccurrent accesses before calling,
      check to make sure read_offset is valid, function does no checks */
@@ -120,11 +177,6 @@ struct Handler {
     return PageResponse::Success;
   }
   
-  bool is_valid_timestamp(const int32_t timestamp) {
-	return timestamp == DEFAULT_TIMESTAMP || 
-           timestamp == page_timestamp;
-  }
-  
   PageResponse write_to_page (off_t&      write_offset, 
                               RecordData& record_data, 
                               const DatabaseType& db_type);
@@ -132,21 +184,36 @@ struct Handler {
                               RecordData& record_data, 
                               const DatabaseType& db_type);
   
-  std::atomic<bool>    is_dirty   = false;
-  std::atomic<bool>    is_pinned  = false;
-  std::atomic<int32_t> page_usage = 0;
+  std::atomic<bool>     is_dirty  = false;
+  std::atomic<int32_t>  pin_count = 0;
+  std::atomic<uint32_t> version   = 0;
 
   int32_t  page_timestamp;
-  int32_t  page_fd  = -1;
-  int32_t  page_num = -1;
+  /* which page the frame holds, set while the frame is claimed and read without 
+     the bundle latch by the flusher and flush_file */
+  std::atomic<int32_t> page_fd  = -1;
+  std::atomic<int32_t> page_num = -1;
   int32_t  page_id  = -1;
-  int32_t  page_ref = 0;
-  PageType page_type;
 
   Page*        page_ptr = nullptr;
   RecordLayout page_layout;
 };
 
+/* RAII guard for changing the bytes of a page, see Handler::begin_write */
+struct PageWriteGuard {
+  PageWriteGuard(Handler& page_handler)
+    : pg_h{page_handler}
+  { pg_h.begin_write(); }
+
+  ~PageWriteGuard() 
+  { pg_h.end_write(); }
+
+  PageWriteGuard(const PageWriteGuard&)            = delete;
+  PageWriteGuard& operator=(const PageWriteGuard&) = delete;
+  
+  Handler& pg_h;
+};
+
 /********************************************************************************/
 
 struct RecId {
@@ -175,20 +242,36 @@ struct RecId {
 /********************************************************************************/
 /* constants used in bufferpool & io_uring */
 constexpr size_t   QUEUE_SIZE     = 1024; /* size of submission and completion queues */
-constexpr uint32_t TOTAL_PAGES    = 640;
-constexpr uint32_t BUFF_RING_SIZE = 512;  /* size of buffer ring we register, must be power of two */ 
-constexpr uint32_t PAGE_POOL_SIZE = TOTAL_PAGES - BUFF_RING_SIZE;
-constexpr uint16_t BGID           = 0;    /* Buffer group id where all our buffers live */
+constexpr uint32_t MAX_FIXED_FILES = 4096; /* most slots in the fixed file table, capped by RLIMIT_NOFILE */
+constexpr uint32_t MAX_LINKED      = 64;   /* most requests in one linked chain */
+constexpr uint32_t MAX_BACKGROUND  = 16;   /* most background requests a ring has in flight */
 
 /* used for facilitating read/write requests. The handle is used to resume a coroutine when the 
    I/O request is completed */
 struct SqeData {
   int32_t status_code = -1;         
-  int32_t buff_id     = -1; /* to determine what buffer read data is in */
   int32_t fd          = -1;
   off_t   offset      = 0;
   IOP	  iop	      = IOP::NullOp;
+  IoPriority priority = IoPriority::Foreground;
   Page*	  page_data   = nullptr;
+  iovec*  iovecs      = nullptr; /* set for vectored I/O instead of page_data */
+  int32_t num_iovecs  = 0;
+  
+  /* file lifecycle requests (OpenAt, MkdirAt, UnlinkAt, Fallocate) */
+  const char* path   = nullptr;
+  int32_t     flags  = 0;
+  mode_t      mode   = 0;
+  off_t       length = 0;
+
+  /* read linked to an IORING_OP_LINK_TIMEOUT, see IoAwaitable, or the 
+     duration of a Timeout */
+  bool              has_timeout = false;
+  __kernel_timespec timeout     = {};
+
+  /* shared by the requests of a linked chain, the coroutine is resumed 
+     when the last of them completes */
+  std::atomic<int32_t>*   num_pending = nullptr;
   std::coroutine_handle<> coroutine;
 };
 
@@ -199,10 +282,18 @@ struct Iouring {
   Iouring& operator=(const Iouring &) = delete;
   Iouring(Iouring &&)		      = delete;
   Iouring& operator=(Iouring &&)      = delete;
-  ~Iouring() { io_uring_queue_exit(&ring); }
+  ~Iouring();
 
+  /* returns the ring the calling thread should submit to, in ring per thread
+     mode (see CoroPool) that is the worker's own ring, otherwise the shared one */
   static Iouring& get_instance() {
-    static Iouring instance;
+    if (local_ring) return *local_ring;
+    return get_shared_instance();
+  }
+
+  /* the ring serviced by the IoProcessor thread */
+  static Iouring& get_shared_instance() {
+    static Iouring instance{RingOwner::Shared};
     return instance;
   }
 
@@ -217,37 +308,153 @@ struct Iouring {
 
   int32_t num_submission_queue_entries() { return io_uring_sq_ready(&ring); }
 
+  /* true if the ring was set up with a kernel submission polling thread */
+  bool is_sq_poll() const { return ring.flags & IORING_SETUP_SQPOLL; }
+
   /* submits all SQE to CQ */
   int32_t submit() { return io_uring_submit(&ring); }
 
+  /* submits whatever is sitting in the submission queue, takes the ring_mutex
+     only for as long as the submit takes */
+  void submit_pending();
+
+  /* blocks until there is at least one entry in the completion queue, only the
+     thread reaping completions should call this */
+  void wait_cqe();
+
   uint32_t submit_and_wait(const uint32_t wait_nr);
   void	   for_each_cqe(const std::function<void(io_uring_cqe*)>& lambda);
 
+  /* The thread reaping completions sleeps in wait_cqe(), to wake it when new SQEs are 
+     queued we keep a read on an eventfd in the ring. A write to the eventfd completes 
+     that read with a nullptr user_data, the reaper then re-arms the read (arm_wake) and 
+     submits everything that was queued. wake_pending makes sure submitters only write to 
+     the eventfd once per wake up, so a busy reaper isn't flooded with writes */
+  void arm_wake();
+  void wake();
+  void force_wake();
+  void consume_wake() 
+  { wake_pending = false; }
+
+  /* fills in the SqeData of a completed request and returns the coroutine waiting
+     on it, for our own wake up reads it re-arms the read and returns nullptr. 
+     Does not mark the cqe as seen */
+  std::coroutine_handle<> complete(io_uring_cqe* cqe);
+
+  /* completes every cqe in the completion queue, appending the coroutines to resume 
+     to ready, then marks them all seen with a single io_uring_cq_advance. Returns the 
+     number of cqes reaped, only the thread reaping completions should call this */
+  uint32_t reap_completions(std::vector<std::coroutine_handle<>>& ready);
+
   /* add a sqe to the submission queue, these functions are thread safe so 
      multiple threads can use this function safely */
   void read_request (SqeData& sqe_data);
   void write_request(SqeData& sqe_data);
+  
+  /* Fsync, Fallocate (length bytes at offset), OpenAt, MkdirAt, UnlinkAt (paths relative to the working directory), 
+     Close and Timeout (completes with -ETIME once sqe_data.timeout has elapsed) */
+  void file_request (SqeData& sqe_data);
 
-  /* register a list of buffers (buff_lst) to a buffer ring (buff_ring) */
-  void register_buffer_ring(io_uring_buf_ring*                buff_ring, 
-                            std::array<Page, BUFF_RING_SIZE>& buff_lst);
+  /* queues the requests as one IOSQE_IO_LINK chain: each starts only after the one 
+     before it succeeded, if one fails the rest complete with -ECANCELED. At most 
+     MAX_LINKED requests, they all share a num_pending counter (see LinkedIoAwaitable) */
+  void linked_request(std::span<SqeData> chain);
+
+  /* registers the page memory with every ring (current and future) so reads and 
+     writes into it go out as READ_FIXED/WRITE_FIXED and the kernel doesn't have to 
+     pin and map the pages on every request. Call once, before any I/O is issued.
+     If the kernel refuses (usually RLIMIT_MEMLOCK) I/O just uses plain read/write */
+  static void register_buffers(std::vector<iovec> buffers);
+
+  /* Every ring has a sparse fixed file table, the slot of a file in it is its fd, 
+     so an SQE for a registered fd only needs IOSQE_FIXED_FILE set, saving the kernel 
+     a fget/fput per request. Registering applies the fd to every ring (current and 
+     future), fds that don't fit in the table are just used as normal */
+  static void register_file  (const int32_t fd);
+  static void unregister_file(const int32_t fd);
 
-  /* adds buffer back to register buffer_ring for re-use */
-  void add_buffer(io_uring_buf_ring* buff_ring, 
-                  Page&              buff,
-                  const uint32_t     buff_id);
-  
 
   /* multiple threads access rings, used to prevent data races */
   std::mutex ring_mutex;
 
+  /* the ring the current thread owns, only set on CoroPool workers in 
+     ring per thread mode */
+  static inline thread_local Iouring* local_ring = nullptr;
+
 private:
-  Iouring() {
-    if (auto err = io_uring_queue_init(QUEUE_SIZE, &ring, 0);
-        err < 0)
-      throw std::runtime_error("Error: initializing io_uring, " + 
-                               std::to_string(err));
+  friend struct CoroPool;
+
+  /* a Shared ring is submitted to by any thread so every submission takes the 
+     ring_mutex, a Local ring is only ever touched by the thread that owns it, 
+     which submits and reaps completions itself without locking */
+  enum class RingOwner { 
+    Shared, 
+    Local 
+  };
+
+  Iouring(const RingOwner ring_owner);
+
+  std::unique_lock<std::mutex> lock_sq() {
+    if (owner == RingOwner::Local) return {};
+    return std::unique_lock<std::mutex>{ring_mutex};
   }
+
+  /* gets a free SQE, if the submission queue is full we submit to make room,
+     must hold the ring_mutex */
+  io_uring_sqe* get_sqe();
+  void          prep_request(io_uring_sqe* sqe, 
+                             SqeData&      sqe_data);
+  
+  /* preps the request and its linked timeout if it has one, must hold the ring_mutex */
+  void          queue_request(SqeData& sqe_data);
+
+  /* a background request over MAX_BACKGROUND is deferred instead of being queued,
+     returns false if it was, must hold the ring_mutex */
+  bool admit_request(SqeData& sqe_data);
+  
+  /* a background request completed, queues the next deferred one */
+  void release_background();
+
+  /* after queueing an SQE either push it to the kernel ourselves (SQPOLL, where 
+     submitting is just a tail update) or wake the reaper to submit it for us */
+  void notify_submit();
+  void init_wake_fd();
+
+  /* sets up the sparse fixed file table, then adds the ring to the registry 
+     filling in the files and buffers already registered */
+  void init_fixed_files();
+  void join_registry();
+  void update_fixed_buffers();
+
+  /* index of the registered buffer holding page, -1 if there is none */
+  int32_t find_fixed_buffer(const Page* page) const;
+  void update_fixed_file(const int32_t slot, 
+                         const int32_t fd);
+  void set_fixed_file   (io_uring_sqe* sqe, 
+                         const int32_t fd) const;
   
-  struct io_uring ring;
+  struct io_uring   ring;
+  RingOwner         owner;
+  int32_t           wake_fd      = -1;
+  uint64_t          wake_value   = 0;
+  std::atomic<bool> wake_pending = false;
+
+  /* user_data of linked timeouts, their completions are ignored */
+  static inline SqeData link_timeout_data;
+
+  uint32_t             num_background = 0;
+  std::deque<SqeData*> deferred_background;
+
+  uint32_t                             num_fixed_files = 0;
+  std::unique_ptr<std::atomic<bool>[]> fixed_files;
+
+  /* every ring that exists and every fd registered, used to keep the 
+     fixed file table of each ring the same */
+  static inline std::mutex                  registry_mutex;
+  static inline std::vector<Iouring*>       rings;
+  static inline std::unordered_set<int32_t> fixed_fds;
+  static inline std::vector<iovec>          fixed_buffers;
+
+  /* copy of fixed_buffers, empty if this ring could not register them */
+  std::vector<iovec> ring_buffers;
 };
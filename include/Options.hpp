@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/* eviction policy of the buffer pool, see Replacer.hpp */
+enum class ReplacerType {
+  Clock,
+  TwoQ
+};
+
+/* what main() does after the command line is parsed: start the database, or exit 
+   right away, successfully after --help, with an error status on a bad argument */
+enum class ParseResult {
+  Run,
+  ExitOk,
+  ExitError
+};
+
+/* Startup options for the database. main() fills these in from the command line
+   before any of the singletons (Iouring, CoroPool, DiskManager) are created, after
+   that they are only ever read, so no synchronization is needed */
+struct Options {
+  Options(const Options&)            = delete;
+  Options(Options&&)                 = delete;
+  Options& operator=(const Options&) = delete;
+  Options& operator=(Options&&)      = delete;
+
+  static Options& get_instance() {
+    static Options instance;
+    return instance;
+  }
+
+  /* parses the command line, prints the usage and returns ExitError if an argument
+     is not understood, --help prints it to std::cout and returns ExitOk */
+  ParseResult parse(const int argc, char** argv);
+  void print_usage(const std::string_view program, std::ostream& out = std::cerr) const;
+
+  /* io_uring submission options: when sq_poll is set a kernel thread polls the
+     submission queue so submitting requests does not need an io_uring_enter syscall,
+     the thread goes to sleep after sq_idle_ms of no work */
+  bool     sq_poll    = false;
+  uint32_t sq_idle_ms = 1000;
+  int32_t  sq_cpu     = -1; /* cpu the polling thread is bound to, -1 lets the kernel pick */
+
+  /* thread per core mode: every CoroPool worker is bound to a cpu and owns its own 
+     ring, it submits without locking, reaps its own completions and resumes the 
+     waiting coroutine itself, instead of going through the IoProcessor thread */
+  bool ring_per_thread = false;
+
+  /* number of CoroPool worker threads, the IoProcessor thread comes on top of these */
+  uint32_t threads = 1;
+
+  /* open the table and index data files of this database with O_DIRECT, the buffer 
+     pool is then the only cache of their pages instead of keeping a second copy in 
+     the OS page cache */
+  bool direct_io = false;
+
+  /* every SELECT has to finish within this, otherwise its I/O is cancelled and it 
+     fails with DeadlineExceeded. Statements that change a table run without one, 
+     they can't be stopped halfway through. 0 means no limit */
+  uint32_t query_timeout_ms = 0;
+
+  /* table and index files are grown this many MiB at a time with fallocate, ahead of 
+     the pages being written, instead of a page at a time as writes land past the end 
+     of the file. 0 turns preallocation off */
+  static constexpr uint32_t MAX_EXTENT_MB = 64;
+  uint32_t extent_mb = 4;
+
+  /* how the buffer pool picks the page to evict when it is full: CLOCK, or 2Q which 
+     keeps pages that are only touched once (scans) from pushing out the working set */
+  ReplacerType replacer = ReplacerType::Clock;
+
+  /* size of the buffer pool in pages, allocated as one arena at startup, with 
+     huge_pages the arena is backed by 2 MiB pages to cut TLB misses on large pools */
+  static constexpr uint32_t MIN_POOL_PAGES = 8;
+  uint32_t pool_pages = 640;
+  bool     huge_pages = false;
+
+  /* background writeback: every flush_interval_ms the flusher writes out the dirty 
+     pages that have been dirty for dirty_age_ms, and the oldest others while more 
+     than dirty_ratio percent of the pool is dirty, so evictions find clean pages. 
+     An interval of 0 turns it off */
+  uint32_t flush_interval_ms = 100;
+  uint32_t dirty_age_ms      = 1000;
+  uint32_t dirty_ratio       = 10;
+
+  /* most pages read ahead of a sequential reader of a file, the window starts small 
+     and doubles up to this while the reads stay sequential. 0 turns readahead off */
+  uint32_t readahead_pages = 64;
+
+  /* a full table scan reads through a private ring of this many frames, recycling 
+     them as it goes, instead of pushing the rest of the buffer pool out. 0 lets 
+     scans use the whole pool */
+  uint32_t scan_ring_pages = 32;
+
+private:
+  Options() = default;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Iouring.hpp"
+
+constexpr size_t HUGE_PAGE_SIZE  = 2 * 1024 * 1024;
+constexpr size_t MAX_FIXED_BYTES = 1024 * 1024 * 1024; /* largest buffer io_uring registers */
+
+/* The memory of the buffer pool: one anonymous mapping holding every frame, sized at
+   startup (Options::pool_pages). With huge pages it is backed by explicit 2 MiB huge
+   pages (MAP_HUGETLB) if the system has enough reserved, otherwise by transparent
+   huge pages, so a large pool takes far fewer TLB entries. Mapped memory is page
+   aligned, so every frame can be the target of O_DIRECT I/O */
+struct PageArena {
+  PageArena(const size_t num_pages,
+            const bool   use_huge_pages)
+    : num_pages  {num_pages},
+      arena_bytes{round_up(num_pages * PAGE_SIZE, use_huge_pages ? HUGE_PAGE_SIZE : PAGE_SIZE)}
+  {
+    constexpr int32_t map_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+
+    if (use_huge_pages) {
+      arena = mmap(nullptr, arena_bytes, PROT_READ | PROT_WRITE, map_flags | MAP_HUGETLB, -1, 0);
+
+      if (arena == MAP_FAILED)
+        std::cerr << "Warning: no reserved huge pages for the buffer pool (" << std::strerror(errno)
+                  << "), using transparent huge pages\n";
+    }
+
+    if (arena == MAP_FAILED) {
+      arena = mmap(nullptr, arena_bytes, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+      if (arena == MAP_FAILED)
+        throw std::runtime_error("Error: allocating the buffer pool, " +
+                                 std::string{std::strerror(errno)});
+
+      if (use_huge_pages) madvise(arena, arena_bytes, MADV_HUGEPAGE);
+    }
+  }
+
+  ~PageArena()
+  { munmap(arena, arena_bytes); }
+
+  PageArena(const PageArena&)            = delete;
+  PageArena& operator=(const PageArena&) = delete;
+
+  std::span<Page> pages() const
+  { return {static_cast<Page*>(arena), num_pages}; }
+
+  /* the arena cut into the buffers to register with io_uring, none bigger than
+     io_uring allows */
+  std::vector<iovec> fixed_buffers() const {
+    std::vector<iovec> buffers;
+    auto*              base = static_cast<uint8_t*>(arena);
+
+    for (size_t offset = 0; offset < num_pages * PAGE_SIZE; offset += MAX_FIXED_BYTES)
+      buffers.push_back(iovec{base + offset,
+                              std::min(MAX_FIXED_BYTES, num_pages * PAGE_SIZE - offset)});
+
+    return buffers;
+  }
+
+private:
+  static size_t round_up(const size_t bytes,
+                         const size_t alignment)
+  { return (bytes + alignment - 1) / alignment * alignment; }
+
+  size_t num_pages;
+  size_t arena_bytes;
+  void*  arena = MAP_FAILED;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+constexpr int32_t NO_FRAME = -1;
+
+/* Page table of a PageBundle: maps (fd, page_num) to the frame (page_id) holding that 
+   page. An open addressing hash map with linear probing, at least twice as many slots 
+   as frames so probes stay short however large the pool is. Erasing shifts the entries 
+   after it back instead of leaving tombstones, so a table that sees constant loads and 
+   evictions never degrades. Lookups only share the table_mutex, loads and evictions 
+   take it exclusively */
+struct PageTable {
+  PageTable(const size_t num_frames)
+    : slots(std::bit_ceil(std::max<size_t>(2 * num_frames, 2))),
+      mask {slots.size() - 1}
+  {};
+
+  /* frame holding the page, NO_FRAME if it isn't in the pool */
+  int32_t find(const int32_t fd, 
+               const int32_t page_num) const 
+  {
+    const uint64_t key = make_key(fd, page_num);
+    std::shared_lock lock{table_mutex};
+
+    for (size_t slot = home_slot(key); slots[slot].page_id != NO_FRAME; slot = (slot + 1) & mask)
+      if (slots[slot].key == key) 
+        return slots[slot].page_id;
+
+    return NO_FRAME;
+  }
+
+  /* maps the page to page_id, if the page is already mapped (someone else loaded it 
+     at the same time) nothing changes and the frame it is mapped to is returned */
+  int32_t insert(const int32_t fd, 
+                 const int32_t page_num, 
+                 const int32_t page_id) 
+  {
+    const uint64_t key = make_key(fd, page_num);
+    std::unique_lock lock{table_mutex};
+
+    size_t slot = home_slot(key);
+    for (; slots[slot].page_id != NO_FRAME; slot = (slot + 1) & mask)
+      if (slots[slot].key == key) 
+        return slots[slot].page_id;
+
+    slots[slot] = Slot{key, page_id};
+    return page_id;
+  }
+
+  /* unmaps the page, only if it is mapped to page_id */
+  void erase(const int32_t fd, 
+             const int32_t page_num, 
+             const int32_t page_id) 
+  {
+    const uint64_t key = make_key(fd, page_num);
+    std::unique_lock lock{table_mutex};
+
+    size_t hole = home_slot(key);
+    for (; slots[hole].key != key || slots[hole].page_id != page_id; hole = (hole + 1) & mask)
+      if (slots[hole].page_id == NO_FRAME) return;
+
+    /* an entry after the hole moves back into it, unless its home slot is 
+       between the hole and where it sits (it would then be unreachable) */
+    for (size_t slot = (hole + 1) & mask; slots[slot].page_id != NO_FRAME; slot = (slot + 1) & mask) {
+      const size_t home = home_slot(slots[slot].key);
+      if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+        slots[hole] = slots[slot];
+        hole        = slot;
+      }
+    }
+
+    slots[hole].page_id = NO_FRAME;
+  }
+
+private:
+  struct Slot {
+    uint64_t key     = 0;
+    int32_t  page_id = NO_FRAME;
+  };
+
+  static uint64_t make_key(const int32_t fd, 
+                           const int32_t page_num) 
+  { return (static_cast<uint64_t>(fd) << 32) | static_cast<uint32_t>(page_num); }
+
+  /* fibonacci hashing, page numbers of a file are consecutive 
+     so the low bits alone would cluster */
+  size_t home_slot(const uint64_t key) const 
+  { return (key * 0x9E3779B97F4A7C15ull) >> (64 - std::countr_zero(slots.size())); }
+
+  std::vector<Slot>         slots;
+  size_t                    mask;
+  mutable std::shared_mutex table_mutex;
+};
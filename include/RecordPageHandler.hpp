@@ -6,10 +6,10 @@
 
 #include <mutex>
 #include <set>
-#include <shared_mutex>
 #include <stdexcept>
 #include <string>
 #include <memory>
+#include <utility>
 #include <variant>
 
 #include "Iouring.hpp"
@@ -58,17 +58,18 @@ struct RecordPageHandler {
       page_cursor{0},
       num_records{0},
       record_size{0},
-      handler_ptr {nullptr}, 
-      rw_mutex_ptr{nullptr}
+      handler_ptr {nullptr}
   {};
 
+  /* takes over the pin of a handler from DiskManager::read_page or create_page */
   RecordPageHandler(Handler* handler);
   ~RecordPageHandler();
 
   /* these operators are only meant to be used when creating and returning a RecordPageHandler
-     not safe to move a RecordPageHandler in use */
-  RecordPageHandler(RecordPageHandler&& other) noexcept = default;
-  RecordPageHandler& operator=(RecordPageHandler&& other) noexcept = default;
+     not safe to move a RecordPageHandler in use. The pin moves with it, the moved from
+     handler no longer holds the page */
+  RecordPageHandler(RecordPageHandler&& other) noexcept;
+  RecordPageHandler& operator=(RecordPageHandler&& other) noexcept;
 
   RecId          add_record   (Record&        record); 
   RecId          delete_record(const int32_t record_num); 
@@ -106,6 +107,15 @@ private:
                 sizeof(num_records));
   }
  
+  /* writes back the header if the page was changed through us and drops our pin */
+  void release_page();
+
+  void mark_modified() {
+    is_modified           = true;
+    handler_ptr->is_dirty = true;
+  }
+  
+  /* call with the page write latched (PageWriteGuard) */
   void compact_page();
   PageResponse move_record(const uint32_t from_record,
                            const uint32_t to_record);
@@ -116,7 +126,10 @@ private:
   int32_t record_size;
  
   Handler* handler_ptr;
-  std::unique_ptr<std::shared_mutex> rw_mutex_ptr; 
+  
+  /* the page was changed through us, kept apart from the shared dirty bit which 
+     the flusher clears when it writes the page out while we still hold it */
+  bool     is_modified = false;
   std::set<uint32_t, std::greater<uint32_t>> tombstones;
 };
 
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Options.hpp"
+#include "PageTable.hpp"
+
+/* Eviction policy of a PageBundle, it tracks the frames that hold a page and picks
+   which of them to give up when the bundle is full. The DiskManager tells it when a
+   page is loaded into a frame, every time the page of a frame is handed out again
+   and when a frame is freed. Replacers lock themselves, they are called from every
+   worker */
+struct Replacer {
+  virtual ~Replacer() = default;
+
+  /* a page was loaded into the frame, is_accessed is false for pages that were only
+     read ahead (read_pages) and have not been asked for yet */
+  virtual void record_load(const int32_t page_id,
+                           const bool    is_accessed)             = 0;
+  /* the page of the frame was handed out (and is about to be pinned) again */
+  virtual void record_access(const int32_t page_id)               = 0;
+  /* the frame was freed, it is no longer a candidate. False if it wasn't tracked 
+     (picked as a victim or removed already) */
+  virtual bool remove(const int32_t page_id)                      = 0;
+
+  /* picks the frame to evict among the tracked frames can_evict accepts and stops
+     tracking it, NO_FRAME if there is none */
+  [[nodiscard]] virtual int32_t
+  pick_victim(const std::function<bool(const int32_t)>& can_evict) = 0;
+};
+
+/* the replacer chosen with --replacer for a bundle of num_frames frames */
+std::unique_ptr<Replacer> make_replacer(const size_t num_frames);
+
+/********************************************************************************/
+
+/* CLOCK (second chance): a hand sweeps over the frames, a frame whose reference bit
+   is set gets the bit cleared and is passed over, the first one without it is the
+   victim. Close to LRU without touching a list on every access */
+struct ClockReplacer : Replacer {
+  ClockReplacer(const size_t num_frames)
+    : is_tracked(num_frames, false),
+      ref_bits  (num_frames, false)
+  {};
+
+  void    record_load  (const int32_t page_id,
+                        const bool    is_accessed) override;
+  void    record_access(const int32_t page_id) override;
+  bool    remove       (const int32_t page_id) override;
+  int32_t pick_victim  (const std::function<bool(const int32_t)>& can_evict) override;
+
+private:
+  std::mutex        replacer_mutex;
+  std::vector<bool> is_tracked;
+  std::vector<bool> ref_bits;
+  size_t            hand = 0;
+};
+
+/********************************************************************************/
+
+/* Simplified 2Q (Johnson and Shasha): a page starts out in the FIFO probation queue
+   (a1), only a page asked for again while it is there is promoted to the LRU main
+   queue (am). A scan touches each of its pages once, so they all pass through a1 and
+   are evicted from there, the working set in am survives it. Victims come from a1
+   while it holds more than its share (A1_PERCENT) of the frames or am has none */
+struct TwoQReplacer : Replacer {
+  static constexpr size_t A1_PERCENT = 25;
+
+  TwoQReplacer(const size_t num_frames)
+    : frames   (num_frames),
+      a1_target{std::max<size_t>(1, num_frames * A1_PERCENT / 100)}
+  {};
+
+  void    record_load  (const int32_t page_id,
+                        const bool    is_accessed) override;
+  void    record_access(const int32_t page_id) override;
+  bool    remove       (const int32_t page_id) override;
+  int32_t pick_victim  (const std::function<bool(const int32_t)>& can_evict) override;
+
+private:
+  enum class Queue { None, A1, Am };
+
+  struct Frame {
+    Queue                        queue       = Queue::None;
+    bool                         is_accessed = false;
+    std::list<int32_t>::iterator position;
+  };
+
+  /* oldest (least recently used) frame of the queue that can be evicted,
+     NO_FRAME if none can */
+  int32_t find_in(const std::list<int32_t>&                 queue,
+                  const std::function<bool(const int32_t)>& can_evict) const;
+  void    unlink (const int32_t page_id);
+
+  std::mutex         replacer_mutex;
+  std::vector<Frame> frames;
+
+  /* front is the newest page */
+  std::list<int32_t> a1_queue;
+  std::list<int32_t> am_queue;
+  const size_t       a1_target;
+};
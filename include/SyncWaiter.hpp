@@ -20,7 +20,7 @@ template<typename T> struct SyncWaiter;
 template <typename T> struct SyncWaiterPromiseBase {
   std::suspend_never initial_suspend()        { return {}; } /* start running the SyncWaiter coroutine right away */
   auto		     final_suspend() noexcept { return FinalAwaitable{}; }
-  void		     unhandled_exception()    { std::terminate(); }
+  void		     unhandled_exception()    { exception = std::current_exception(); }
   
   /* called when the SyncWaiter coroutine is completing */
   struct FinalAwaitable {
@@ -38,7 +38,8 @@ template <typename T> struct SyncWaiterPromiseBase {
     void await_resume()	noexcept {}
   };
   
-  std::atomic_flag completion_flag = ATOMIC_FLAG_INIT; 
+  std::atomic_flag   completion_flag = ATOMIC_FLAG_INIT; 
+  std::exception_ptr exception;
 };
 
 /********************************************************************************/
@@ -70,7 +71,13 @@ template <typename T> struct [[nodiscard]] SyncWaiter {
   SyncWaiter(std::coroutine_handle<SyncWaiterPromise<T>> coro)
     : coroutine{coro} {}
   
-  void wait()       { coroutine.promise().completion_flag.wait(false); }
+  /* rethrows what the Task we waited on threw */
+  void wait() { 
+    coroutine.promise().completion_flag.wait(false); 
+    if (coroutine.promise().exception)
+      std::rethrow_exception(coroutine.promise().exception);
+  }
+  
   T    get_result() { return coroutine.promise().get_result(); }
 
   std::coroutine_handle<SyncWaiterPromise<T>> coroutine;
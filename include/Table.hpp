@@ -1,11 +1,13 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
 #include <stdexcept>
 #include <string>
 
 #include "DiskManager.hpp"
 #include "FileDescriptor.hpp"
+#include "FileOps.hpp"
 #include "IndexManager.hpp"
 #include "RecordPageHandler.hpp"
 #include "TableMetaData.hpp"
@@ -16,15 +18,21 @@
 /********************************************************************************/
 
 struct Table {
-  Table(std::filesystem::path table_data_file,
-        std::filesystem::path table_meta_data_file,
+  /* the files are opened already, see open */
+  Table(FileDescriptor        table_data_fd,
+        FileDescriptor        table_meta_data_fd,
         std::filesystem::path index_folder)
     : disk_manager  {DiskManager::get_instance()},
-      meta_data     {table_meta_data_file.string()},
+      meta_data     {std::move(table_meta_data_fd)},
       index_manager {index_folder},
-      table_pages_fd{table_data_file.string()}
+      table_pages_fd{std::move(table_data_fd)}
   {};
 
+  /* opens the files of an existing table with open_async */
+  [[nodiscard]] static Task<std::unique_ptr<Table>> open(const std::filesystem::path table_data_file,
+                                                         const std::filesystem::path table_meta_data_file,
+                                                         const std::filesystem::path index_folder);
+
   Task<std::vector<TableRecord>> execute_command(const SQLStatement sql_stmt);
   Task<void> execute_delete(const SQLStatement& sql_stmt);
   Task<void> execute_update(const SQLStatement& sql_stmt);
@@ -32,6 +40,13 @@ struct Table {
   
   Task<std::vector<TableRecord>> execute_select_no_join(const SQLStatement& sql_stmt);
 
+  /* the table is being dropped, the pages of its files are dropped from the buffer 
+     pool without being written before the files are closed and removed */
+  Task<void> drop_pages() {
+    co_await disk_manager.drop_file(table_pages_fd.fd);
+    co_await index_manager.drop_pages();
+  }
+
 private:
   Task<std::vector<RecId>> search_table(const SQLStatement& sql_stmt);
   Task<std::vector<RecId>> find_matches(const SQLStatement& sql_stmt);
@@ -46,7 +61,9 @@ private:
   
   std::pair<std::vector<std::string>, Record> get_equality_attr(const SQLStatement& sql_stmt);
 
-  [[nodiscard]] Task<RecordPageHandler> get_page(const int32_t page_num);
+  /* ring is the ScanRing of a full table scan, see find_matches */
+  [[nodiscard]] Task<RecordPageHandler> get_page(const int32_t page_num,
+                                                 ScanRing*     ring = nullptr);
   [[nodiscard]] Task<RecordPageHandler> create_page();
   
   DiskManager&         disk_manager;
@@ -1,24 +1,35 @@
 #pragma once
 
 #include <atomic>
+#include <exception>
+#include <iostream>
+#include <sys/uio.h>
+
+#include <span>
+#include <vector>
 
 #include "FileDescriptor.hpp"
+#include "IoAwaitable.hpp"
+#include "Task.hpp"
 #include "Util.hpp"
 
 struct TableMetaData {
-  TableMetaData(const std::string data_file)
-    : meta_data_file{data_file} 
+  /* meta_data_file_fd is the opened meta data file, see open_async */
+  TableMetaData(FileDescriptor meta_data_file_fd)
+    : meta_data_fd{std::move(meta_data_file_fd)}
   { read_meta_data(); };
 
   TableMetaData(const SQLStatement& sql_stmt,
                 const RecordLayout  table_record_layout, 
-                const std::string   data_file)
+                FileDescriptor      meta_data_file_fd)
     : num_attr      {sql_stmt.num_attr},
       num_primary   {sql_stmt.num_primary},
       num_foreign   {sql_stmt.num_foreign},
       num_pages     {-1},
-      meta_data_file{data_file},
-      record_layout {table_record_layout}
+      num_allocated {0},
+      meta_data_fd  {std::move(meta_data_file_fd)},
+      record_layout {table_record_layout},
+      is_dirty      {true}
   {
     for(int32_t i = 0; i < sql_stmt.num_primary; ++i)
       primary_key.push_back(sql_stmt.prim_key[i]);
@@ -31,7 +42,17 @@ struct TableMetaData {
                                 sql_stmt.foreign_table[i]);
   }
      
-  ~TableMetaData() { write_meta_data(); }
+  /* last chance for changes that were never flushed, this write blocks */
+  ~TableMetaData() { 
+    if (!is_dirty) return;
+    
+    try {
+      const std::vector<uint8_t> buffer = serialize();
+      meta_data_fd.file_write(buffer.data(), buffer.size(), 0);
+    } catch (const std::exception& error) {
+      std::cerr << "Error: Cannot write table meta data dtor(), " << error.what() << "\n";
+    }
+  }
 
   struct ForeignInfo {
     ForeignInfo(const std::string f_key, 
@@ -67,8 +88,43 @@ struct TableMetaData {
   const std::vector<ForeignInfo>& get_foreign_info() const 
   { return foreign_info; }
 
-  void increase_num_pages() { ++num_pages; }
-  void decrease_num_pages() { --num_pages; }
+  void increase_num_pages() { ++num_pages; is_dirty = true; }
+  void decrease_num_pages() { --num_pages; is_dirty = true; }
+
+  /* pages preallocated in the table file, num_pages of them are in use */
+  const int32_t get_num_allocated() const
+  { return num_allocated.load(); }
+
+  void set_num_allocated(const int32_t allocated_pages) 
+  { num_allocated = allocated_pages; is_dirty = true; }
+
+  /* Writes the meta data out with a single io_uring write if it changed since the last 
+     flush. Changes only mark the meta data dirty, so every change made by a statement 
+     goes out in one write when the statement calls flush at its end. A flush that 
+     starts while another is in flight leaves the writing to that one, which loops 
+     until nothing is dirty. A change that lands after the writer last looked but 
+     before it lets go of is_flushing is caught by it looking again once it has */
+  Task<void> flush() {
+    while (is_dirty && !is_flushing.exchange(true)) {
+      while (is_dirty.exchange(false)) {
+        std::vector<uint8_t> buffer = serialize();
+        iovec io_vec {buffer.data(), buffer.size()};
+        
+        const int32_t bytes_written = co_await IoAwaitable{meta_data_fd.fd, 
+                                                           0, 
+                                                           std::span{&io_vec, 1}, 
+                                                           IOP::Write};
+        /* leave it dirty, the next flush (or the destructor) tries again */
+        if (bytes_written != std::ssize(buffer)) {
+          is_dirty    = true;
+          is_flushing = false;
+          co_return;
+        }
+      }
+      
+      is_flushing = false;
+    }
+  }
   
   size_t get_attr_idx(const std::string& attr) const {
     auto itr = std::find(std::begin(attr_list), 
@@ -86,34 +142,38 @@ struct TableMetaData {
   }
 
 private:
-  void write_meta_data() {
-    FileDescriptor out{meta_data_file};
+  std::vector<uint8_t> serialize() const {
+    std::vector<uint8_t> buffer;
 
     int32_t np_write = num_pages.load(); 
-    out.file_write(&num_attr   , sizeof(num_attr));
-    out.file_write(&np_write   , sizeof(np_write));
-    out.file_write(&num_primary, sizeof(num_primary));
-    out.file_write(&num_foreign, sizeof(num_foreign));
+    append_bytes(buffer, &num_attr   , sizeof(num_attr));
+    append_bytes(buffer, &np_write   , sizeof(np_write));
+    append_bytes(buffer, &num_primary, sizeof(num_primary));
+    append_bytes(buffer, &num_foreign, sizeof(num_foreign));
 
     for (int32_t i = 0; i < num_primary; ++i)
-      write_string_to_file(out, primary_key[i]);
+      append_string(buffer, primary_key[i]);
 
     for (int32_t i = 0; i < num_attr; ++i)
-      write_string_to_file(out, attr_list[i]);
+      append_string(buffer, attr_list[i]);
 
     for (int32_t i = 0; i < num_foreign; ++i) {
-      write_string_to_file(out, foreign_info[i].foreign_key);
-      write_string_to_file(out, foreign_info[i].foreign_table);
+      append_string(buffer, foreign_info[i].foreign_key);
+      append_string(buffer, foreign_info[i].foreign_table);
     }
 
     for (int32_t i = 0; i < num_attr; ++i)
-      out.file_write(&record_layout[i], sizeof(DatabaseType));
+      append_bytes(buffer, &record_layout[i], sizeof(DatabaseType));
+
+    int32_t na_write = num_allocated.load();
+    append_bytes(buffer, &na_write, sizeof(na_write));
+    return buffer;
   }
 
   /*************************/
   
   void read_meta_data() {
-    FileDescriptor in{meta_data_file};
+    FileDescriptor& in = meta_data_fd;
     
     int32_t np_read;
     in.file_read(&num_attr   , sizeof(num_attr));
@@ -139,16 +199,22 @@ private:
       in.file_read(&db_type, sizeof(db_type));
       record_layout.push_back(db_type);
     }
+
+    /* written before extents existed, nothing was preallocated */
+    int32_t na_read;
+    if (in.file_read(&na_read, sizeof(na_read)) != sizeof(na_read))
+      na_read = 0;
+    num_allocated = na_read;
   }
 
   /*************************/
   
-  void write_string_to_file(FileDescriptor& out, 
-                            const std::string& str) 
+  static void append_string(std::vector<uint8_t>& buffer, 
+                            const std::string&    str) 
   {
     int32_t str_size = str.size();
-    out.file_write(&str_size, sizeof(str_size));
-    out.file_write(str.c_str(), str_size);
+    append_bytes(buffer, &str_size, sizeof(str_size));
+    append_bytes(buffer, str.c_str(), str_size);
   }
 
   std::string read_string_from_file(FileDescriptor& in) {
@@ -165,10 +231,14 @@ private:
   int32_t num_foreign;
   int32_t num_primary;
   std::atomic<int32_t> num_pages;
+  std::atomic<int32_t> num_allocated;
  
-  std::string meta_data_file;
+  FileDescriptor meta_data_fd;
   RecordLayout record_layout;
   std::vector<std::string> primary_key;
   std::vector<std::string> attr_list;
   std::vector<ForeignInfo> foreign_info;
+
+  std::atomic<bool> is_dirty    = false;
+  std::atomic<bool> is_flushing = false;
 };
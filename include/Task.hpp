@@ -1,14 +1,37 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <coroutine>
 #include <exception>
 #include <iostream>
+#include <stdexcept>
 #include <utility>
 
 template<typename T> struct TaskPromise;
 template<typename T> struct Task;
 
+/* A Task can be given a deadline (see Task::set_deadline), every Task it co_awaits 
+   inherits it, IoAwaitable reads are cancelled with a linked timeout when it passes
+   and DeadlineExceeded is thrown up the chain of Tasks */
+using Deadline = std::chrono::steady_clock::time_point;
+constexpr Deadline NO_DEADLINE = Deadline::max();
+
+struct DeadlineExceeded : std::runtime_error {
+  DeadlineExceeded()
+    : std::runtime_error{"Error: query deadline exceeded"}
+  {};
+};
+
+/* deadline of the coroutine behind handle, NO_DEADLINE if it isn't a Task */
+template <typename Promise>
+Deadline deadline_of(std::coroutine_handle<Promise> handle) {
+  if constexpr (requires { handle.promise().deadline; })
+    return handle.promise().deadline;
+  else return NO_DEADLINE;
+}
+
 /* This structure defines what the promise type for our Task type will be,
    crucially it ensures that when a Task is finishing it starts up its parent
    coroutine, if the Tasks has no parent it justs start a std::noop_coroutine (ie:
@@ -19,7 +42,15 @@ template<typename T> struct Task;
 template <typename T> struct TaskPromiseBase {
   std::suspend_always initial_suspend()        { return {}; } /* only evaluate coroutine when co_await is called */
   auto                final_suspend() noexcept { return FinalAwaitable{}; }
-  void                unhandled_exception()    { std::terminate(); }
+  
+  /* the exception is rethrown in the parent when it resumes, see TaskAwaitable */
+  void unhandled_exception() 
+  { exception = std::current_exception(); }
+  
+  void rethrow_if_failed() {
+    if (exception) 
+      std::rethrow_exception(exception);
+  }
   
   /* awaitable that is used to continue the parent coroutine after child is done
      running, this is called when the child is finished running */
@@ -44,6 +75,8 @@ template <typename T> struct TaskPromiseBase {
      coroutine because it instantiates a call to another coroutine, called the child, when 
      this child coroutine is done it will resume this parent coroutine function */
   std::coroutine_handle<> parent_coroutine = std::noop_coroutine();
+  Deadline                deadline         = NO_DEADLINE;
+  std::exception_ptr      exception;
 };
 
 /********************************************************************************/
@@ -102,6 +135,10 @@ template <typename T> struct [[nodiscard]] Task {
     coroutine.resume();
   }
 
+  /* call before the Task is started */
+  void set_deadline(const Deadline deadline) 
+  { coroutine.promise().deadline = deadline; }
+
   struct TaskAwaitable {
     /* this task has been called with a co_await operator on it,
        this now means it is within some other coroutine, this coroutine
@@ -115,15 +152,25 @@ template <typename T> struct [[nodiscard]] Task {
     { return !child_coroutine || child_coroutine.done(); } 
     
     /* suspend the parent coroutine function and start running the child coroutine */
-    std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent_coroutine) noexcept {
+    template <typename ParentPromise>
+    std::coroutine_handle<> 
+    await_suspend(std::coroutine_handle<ParentPromise> parent_coroutine) noexcept {
       /* give the child its parent coroutine so it knows what to start back up 
-         when it finishes running. The parent is stuck until the child is done */
-      child_coroutine.promise().parent_coroutine = parent_coroutine;
+         when it finishes running. The parent is stuck until the child is done.
+         The child has to finish by the parents deadline too */
+      auto& child_promise = child_coroutine.promise();
+      
+      child_promise.parent_coroutine = parent_coroutine;
+      child_promise.deadline         = std::min(child_promise.deadline, 
+                                                deadline_of(parent_coroutine));
       return child_coroutine;
     }
     
-    /* return back the data the child Task promises to return */
-    auto await_resume() noexcept -> decltype(auto) {
+    /* return back the data the child Task promises to return, or throw 
+       what the child threw */
+    auto await_resume() -> decltype(auto) {
+      child_coroutine.promise().rethrow_if_failed();
+      
       if constexpr (!std::is_same_v<T, void>)
         return child_coroutine.promise().get_result();
     }
@@ -145,3 +192,30 @@ template <> struct TaskPromise<void> : TaskPromiseBase<void> {
 
   void return_void() {}
 };
+
+/********************************************************************************/
+
+/* co_await check_deadline() throws DeadlineExceeded if the deadline of the Task it 
+   is in has passed, for long loops that may not do any I/O (pages already cached) */
+struct DeadlineCheck {
+  bool await_ready() const 
+  { return false; }
+
+  /* never actually suspends */
+  template <typename Promise>
+  bool await_suspend(std::coroutine_handle<Promise> coroutine) {
+    const Deadline deadline = deadline_of(coroutine);
+    is_expired = deadline != NO_DEADLINE && 
+                 deadline <= std::chrono::steady_clock::now();
+    return false;
+  }
+
+  void await_resume() const {
+    if (is_expired) throw DeadlineExceeded{};
+  }
+
+  bool is_expired = false;
+};
+
+[[nodiscard]] inline DeadlineCheck check_deadline() 
+{ return DeadlineCheck{}; }
@@ -97,6 +97,12 @@ int32_t    calc_record_size(const RecordLayout& layout);
 RecordData cast_to(const std::string  attr_value, 
                    const DatabaseType db_type); 
 
+/* appends the bytes of data to buffer, meta data is serialized this way 
+   so it can be written out with a single write */
+void append_bytes(std::vector<uint8_t>& buffer, 
+                  const void*           data, 
+                  const size_t          size);
+
 /********************************************************************************/
 /* AST information, used for parsing where clauses */
 using RecordComp = std::function<bool(const RecordData&, const RecordData&)>;
@@ -4,12 +4,12 @@
 #include "Iouring.hpp"
 #include <stdexcept>
 
-BTree::BTree(IndexMetaData  index_meta_data,
-             FileDescriptor index_pages_filedescriptor)
+BTree::BTree(IndexMetaData index_meta_data,
+             const int32_t index_pages_filedescriptor)
   : undefined_btree {false},
     disk_manager_ptr{&DiskManager::get_instance()},
-    meta_data       {index_meta_data},
-    index_pages_fd  {std::move(index_pages_filedescriptor)}
+    meta_data       {std::move(index_meta_data)},
+    index_pages_fd  {index_pages_filedescriptor}
 {};
   
 /********************************************************************************/
@@ -86,6 +86,8 @@ Task<void> BTree::insert_entry(const Record key,
     /* check if parent has overflow */
     node = parent;
   }
+
+  co_await meta_data.flush();
 }
   
 /********************************************************************************/
@@ -241,7 +243,7 @@ Task<void> BTree::delete_entry(const Record key,
     }
   }
 
-  co_return;
+  co_await meta_data.flush();
 }
 
 /********************************************************************************/
@@ -334,8 +336,9 @@ IndexId BTree::leaf_begin() {
 Task<IndexPageHandler> BTree::get_node(const int32_t page_num) {
   assert(page_num < meta_data.get_num_pages());
 
-  Handler* handler = co_await disk_manager_ptr->read_page(index_pages_fd.fd,
+  Handler* handler = co_await disk_manager_ptr->read_page(index_pages_fd,
                                                           page_num,
+                                                          meta_data.get_num_pages(),
                                                           meta_data.get_key_layout());
   co_return IndexPageHandler{handler, &meta_data};
 }
@@ -347,7 +350,15 @@ Task<IndexPageHandler> BTree::create_node() {
 
   if (meta_data.get_first_free_page() == NO_FREE_PAGE) {
     /* no free pages create a new one, call disk manager */
-    handler = co_await disk_manager_ptr->create_page(index_pages_fd.fd, 
+    if (const int32_t page_num = meta_data.get_num_pages();
+        page_num >= meta_data.get_num_allocated())
+    {
+      meta_data.set_num_allocated(co_await preallocate_async(index_pages_fd,
+                                                             page_num + 1,
+                                                             meta_data.get_num_allocated()));
+    }
+
+    handler = co_await disk_manager_ptr->create_page(index_pages_fd, 
                                                      meta_data.get_num_pages(),
                                                      meta_data.get_key_layout());
     meta_data.increase_num_pages();
@@ -356,7 +367,7 @@ Task<IndexPageHandler> BTree::create_node() {
     /* we have a page in our index file we can reuse */
     IndexPageHandler node {co_await get_node(meta_data.get_first_free_page())};
     meta_data.set_first_free_page(node.get_next_free());
-    node.handler_ptr->is_dirty = true;
+    node.mark_modified();
     co_return node;
   }
 }
@@ -407,7 +418,7 @@ Task<void> BTree::erase_leaf(IndexPageHandler& leaf) {
   assert(leaf.get_is_leaf());
 
   IndexPageHandler prev {co_await get_node(leaf.get_prev_leaf())};
-  prev.handler_ptr->is_dirty = true;
+  prev.mark_modified();
   prev.set_next_leaf(leaf.get_next_leaf());
 
   IndexPageHandler next {co_await get_node(leaf.get_next_leaf())};
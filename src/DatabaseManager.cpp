@@ -2,6 +2,10 @@
 
 Task<std::vector<TableRecord>> DatabaseManager::handle_query(const std::string query_string) {
   std::vector<TableRecord> ret_data;
+  
+  const uint32_t timeout_ms = Options::get_instance().query_timeout_ms;
+  const Deadline deadline   = (timeout_ms == 0) ? NO_DEADLINE : 
+                              std::chrono::steady_clock::now() + std::chrono::milliseconds{timeout_ms};
 
   parser.parse_query(query_string);
   SQLStatement sql_stmt = parser.get_sql_stmt();
@@ -9,8 +13,16 @@ Task<std::vector<TableRecord>> DatabaseManager::handle_query(const std::string q
   co_await coro_pool.schedule();
   switch (sql_stmt.command) {
     case Command::Create: co_await create_table(sql_stmt); break;
-    case Command::Drop  : drop_table(sql_stmt); break;
-    default: ret_data = co_await table_query(sql_stmt); 
+    case Command::Drop  : co_await drop_table(sql_stmt); break;
+    default: {
+      /* only reads get the deadline, a statement that changes the table can't be 
+         stopped halfway through its changes (a row without its index entries, 
+         half a BTree split) */
+      Task<std::vector<TableRecord>> query = table_query(sql_stmt);
+      if (sql_stmt.command == Command::Select) query.set_deadline(deadline);
+      
+      ret_data = co_await query; 
+    }
   }
 
   co_return ret_data;
@@ -21,8 +33,13 @@ Task<std::vector<TableRecord>> DatabaseManager::handle_query(const std::string q
 
 void DatabaseManager::start_cmdline() {
   for (std::string line; std::cout << "CoroDB> " && std::getline(std::cin, line);) {
-    if (!line.empty())
+    if (line.empty()) continue;
+    
+    try {
       auto ret_data = sync_wait(handle_query(line));
+    } catch (const std::exception& error) {
+      std::cerr << error.what() << "\n";
+    }
   }
 }
 
@@ -36,10 +53,11 @@ Task<void> DatabaseManager::create_table(SQLStatement& sql_stmt) {
   const auto table_data_file      = table_folder / "TABLE_DATA_FILE";
   const auto table_meta_data_file = table_folder / "TABLE_META_DATA";
 
-  std::filesystem::create_directories(table_folder);
-  std::filesystem::create_directories(index_folder);
+  /* also creates table_folder */
+  co_await create_directories_async(index_folder);
 
   IndexManager index_manager {index_folder};
+  co_await index_manager.open_catalog();
   RecordLayout table_layout  {std::begin(sql_stmt.table_layout),
                               std::begin(sql_stmt.table_layout) + sql_stmt.num_attr};
   
@@ -49,31 +67,36 @@ Task<void> DatabaseManager::create_table(SQLStatement& sql_stmt) {
   if (response != PageResponse::Success)
     throw std::runtime_error("Error: Unable to Create Table");
 
-  const auto table_data_fd      = FileDescriptor{table_data_file, OpenMode::Create};
-  const auto table_meta_data_fd = FileDescriptor{table_meta_data_file, OpenMode::Create};  
+  co_await create_file_async(table_data_file);
+  co_await create_file_async(table_meta_data_file);
   
-  auto table_ptr = std::make_unique<Table>(table_data_file, 
-                                           table_meta_data_file,
-                                           index_folder);
-
-  loaded_tables[sql_stmt.get_table_name()] = std::move(table_ptr);
+  loaded_tables[sql_stmt.get_table_name()] = std::move(co_await Table::open(table_data_file, 
+                                                                            table_meta_data_file,
+                                                                            index_folder));
 }
 
 /********************************************************************************/
 
-void DatabaseManager::drop_table(const SQLStatement& sql_stmt) {
+Task<void> DatabaseManager::drop_table(const SQLStatement& sql_stmt) {
   const auto table_folder = db_path / sql_stmt.get_table_name();
-  if (!std::filesystem::is_directory(table_folder)) return;
+  
+  /* close the tables files before removing them, their pages leave the buffer pool 
+     first, a page keyed by a closed fd would be taken for a page of the next file 
+     that is given the fd */
+  if (auto table = loaded_tables.find(sql_stmt.get_table_name()); 
+      table != loaded_tables.end()) 
+  {
+    co_await table->second->drop_pages();
+    loaded_tables.erase(table);
+  }
 
-  std::filesystem::remove_all(table_folder);
-  if (loaded_tables.contains(sql_stmt.get_table_name()))
-    loaded_tables.erase(sql_stmt.get_table_name());
+  co_await remove_all_async(table_folder);
 }
 
 /********************************************************************************/
 
-void DatabaseManager::load_table(const std::string table_name) {
-  if (loaded_tables.contains(table_name)) return; 
+Task<void> DatabaseManager::load_table(const std::string table_name) {
+  if (loaded_tables.contains(table_name)) co_return; 
 
   const auto table_folder         = db_path / table_name;
   const auto index_folder         = table_folder / "INDEX_FOLDER";
@@ -86,11 +109,9 @@ void DatabaseManager::load_table(const std::string table_name) {
       !std::filesystem::is_regular_file(table_meta_data_file))
     throw std::runtime_error("Error: Table does not exist cannot fetch table which does not exist");
   
-  auto table_ptr = std::make_unique<Table>(table_data_file, 
-                                           table_meta_data_file,
-                                           index_folder);
-
-  loaded_tables[table_name] = std::move(table_ptr);
+  loaded_tables[table_name] = std::move(co_await Table::open(table_data_file, 
+                                                              table_meta_data_file,
+                                                              index_folder));
 }
 
 /********************************************************************************/
@@ -99,7 +120,7 @@ Task<std::vector<TableRecord>> DatabaseManager::table_query(SQLStatement& sql_st
   if (loaded_tables.contains(sql_stmt.get_table_name()))
     co_return co_await loaded_tables.at(sql_stmt.get_table_name())->execute_command(sql_stmt);
 
-  load_table(sql_stmt.get_table_name());
+  co_await load_table(sql_stmt.get_table_name());
   if (!loaded_tables.contains(sql_stmt.get_table_name()))
     co_return std::vector<TableRecord>{};
 
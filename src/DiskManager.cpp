@@ -1,18 +1,108 @@
 #include "DiskManager.hpp"
 
 DiskManager::DiskManager() 
-  : timestamp_gen{0} 
+  : timestamp_gen{0},
+    arena        {Options::get_instance().pool_pages, Options::get_instance().huge_pages}
 {
-  void* buff_ring = nullptr;
-  bundles         = {&io_bundles, &np_bundles};
+  const int32_t num_frames  = get_num_frames();
+  const int32_t num_bundles = std::clamp<int32_t>(2 * Options::get_instance().threads, 
+                                                  1, num_frames / MIN_BUNDLE_FRAMES);
+  frames_per_bundle = num_frames / num_bundles;
 
-  if (posix_memalign(&buff_ring, PAGE_SIZE, BUFF_RING_SIZE * sizeof(io_uring_buf)))
-    throw std::runtime_error("Error: Error allocating ring buffer memory");
+  for (int32_t bundle = 0; bundle < num_bundles; ++bundle) {
+    const int32_t first_frame = bundle * frames_per_bundle;
+    const int32_t size        = (bundle == num_bundles - 1) ? num_frames - first_frame : 
+                                                              frames_per_bundle;
+    bundles.push_back(std::make_unique<PageBundle>(first_frame, 
+                                                   arena.pages().subspan(first_frame, size)));
+  }
+  
+  Iouring::register_buffers(arena.fixed_buffers());
+
+  if (Options::get_instance().flush_interval_ms == 0) return;
+  dirty_ages.resize(num_frames, 0);
 
-  buff_ring_ptr.reset(reinterpret_cast<io_uring_buf_ring*>(buff_ring));
+  /* the flusher sleeps on a ring and runs on the pool, they have to be 
+     around (constructed first, destroyed last) for as long as we are */
+  Iouring::get_shared_instance();
+  CoroPool::get_instance();
   
-  Iouring::get_instance().register_buffer_ring(buff_ring_ptr.get(), 
-                                               io_bundles.pages);
+  flusher_done = false;
+  spawn_detached(run_flusher());
+}
+
+/********************************************************************************/
+
+DiskManager::~DiskManager() {
+  flusher_stop = true;
+  flusher_done.wait(false);
+
+  for (int32_t pending = num_readaheads; pending > 0; pending = num_readaheads)
+    num_readaheads.wait(pending);
+}
+
+/********************************************************************************/
+
+Task<void> DiskManager::run_flusher() {
+  const Options& options    = Options::get_instance();
+  const uint32_t age_passes = std::max(1u, options.dirty_age_ms / options.flush_interval_ms);
+
+  while (!flusher_stop) {
+    co_await sleep_for(std::chrono::milliseconds{options.flush_interval_ms});
+    co_await write_back(age_passes);
+  }
+
+  flusher_done = true;
+  flusher_done.notify_all();
+}
+
+/********************************************************************************/
+
+Task<void> DiskManager::write_back(const uint32_t age_passes) {
+  std::vector<int32_t> candidates;
+  int32_t              num_dirty = 0;
+
+  for (int32_t page_id = 0; page_id < get_num_frames(); ++page_id) {
+    PageBundle&    bundle = bundle_of(page_id);
+    const Handler& pg_h   = bundle.get_page_handler(page_id);
+    
+    if (!bundle.get_page_used(page_id) || !pg_h.is_dirty) {
+      dirty_ages[page_id] = 0;
+      continue;
+    }
+
+    ++num_dirty;
+    ++dirty_ages[page_id];
+    if (!pg_h.is_pinned()) candidates.push_back(page_id);
+  }
+
+  /* oldest first */
+  std::ranges::sort(candidates, [this](const int32_t lhs, const int32_t rhs) {
+    return dirty_ages[lhs] > dirty_ages[rhs];
+  });
+  
+  const int32_t dirty_limit = get_num_frames() * Options::get_instance().dirty_ratio / 100;
+  
+  for (const int32_t page_id : candidates) {
+    if (dirty_ages[page_id] < age_passes && num_dirty <= dirty_limit) break;
+    
+    /* it may have been pinned, written out or evicted while we were writing the others,
+       a page somebody has pinned is left to them (see try_pin_unpinned) */
+    PageBundle& bundle = bundle_of(page_id);
+    Handler&    pg_h   = bundle.get_page_handler(page_id);
+    if (!pg_h.is_dirty || !bundle.try_pin_unpinned(page_id, pg_h.page_fd, pg_h.page_num)) 
+      continue;
+
+    PinGuard pin_guard{pg_h, std::adopt_lock};
+    co_await write_page(page_id, 
+                        pg_h.page_num,
+                        IoPriority::Background);
+    
+    if (!pg_h.is_dirty) {
+      --num_dirty;
+      dirty_ages[page_id] = 0;
+    }
+  }
 }
 
 /********************************************************************************/
@@ -21,132 +111,540 @@ Task<Handler*> DiskManager::create_page(const int32_t      fd,
                                         const int32_t      page_num,
                                         const RecordLayout layout) 
 {
+  PageBundle& bundle = bundle_for(fd, page_num);
+  
   /* Incase someone tries to create the same page twice */
-  if (const auto find_page = np_bundles.find_page(fd, page_num);
+  if (const auto find_page = bundle.find_page(fd, page_num);
       find_page != -1)
   {
-    auto pg_h = get_page(find_page, 
-                         PageType::NonPersistent);
-    co_return pg_h;
+    if (auto pg_h = get_page(find_page, fd, page_num)) co_return pg_h;
   }
 
-  int32_t page_id = find_first_false(np_bundles.pages_used); 
-  if (page_id == -1)
-    page_id = lru_replacement(PageType::NonPersistent);
+  /* same as read_page, evict a page and if nothing can be evicted wait */
+  const int32_t page_id = co_await acquire_frame(bundle, nullptr); 
 
-  np_bundles.pages_used[page_id] = true;
-  np_bundles.page_handlers[page_id].init_handler(&np_bundles.get_page(page_id),
-                                                 layout,
-                                                 page_id,
-                                                 timestamp_gen++,
-                                                 page_num,
-                                                 fd,
-                                                 PageType::NonPersistent);
+  Page& page = bundle.get_page(page_id);
+  std::fill(page.begin(), page.end(), 0);
   
-  np_bundles.get_page_handler(page_id).is_dirty = true;
-  co_return &np_bundles.page_handlers[page_id];
+  Handler* pg_h = init_page(page_id, fd, page_num, layout, true);
+  pg_h->is_dirty = true;
+  co_return pg_h;
 }
 
 /********************************************************************************/
 
 Task<Handler*> DiskManager::read_page(const int32_t      fd,
                                       const int32_t      page_num,
-                                      const RecordLayout layout) 
+                                      const int32_t      file_pages,
+                                      const RecordLayout layout,
+                                      ScanRing*          ring) 
 {
+  if (!ring) read_ahead(fd, page_num, file_pages, layout);
+  PageBundle& bundle = bundle_for(fd, page_num);
+  
   /* page is in our buffer pool, so we can just return it, no IO */
-  if (const auto find_page = io_bundles.find_page(fd, page_num);
+  if (const auto find_page = bundle.find_page(fd, page_num);
       find_page != -1) 
   {
-    auto pg_h = get_page(find_page, 
-                         PageType::IO); 
-    co_return pg_h;
+    if (auto pg_h = get_page(find_page, fd, page_num)) co_return pg_h;
   }
 
-  /* no free pages for IO so we have to return one */
-  if (find_first_false(io_bundles.pages_used) == -1) {
-    int32_t replaced_page = lru_replacement(PageType::IO); 
-    co_await return_page(replaced_page, 
-                         PageType::IO);
-  } 
+  /* no free pages for IO so we have to return one, if nothing can be evicted
+     wait until a page is returned or can be evicted */
+  const int32_t page_id = co_await acquire_frame(bundle, ring);
 
-  const int32_t page_id = co_await IoAwaitable{fd,
-                                               page_num * PAGE_SIZE,
-                                               IOP::Read};
+  Page& page = bundle.get_page(page_id);
+  const int32_t bytes_read = co_await IoAwaitable{fd,
+                                                  page_num * PAGE_SIZE,
+                                                  IOP::Read,
+                                                  &page};
+  if (bytes_read < 0) {
+    if (ring) keep_in_ring(*ring, page_id, nullptr);
+    bundle.release_frame(page_id);
+    if (IoAwaitable::is_deadline_error(bytes_read)) 
+      throw DeadlineExceeded{};
+    throw std::runtime_error("Error: Cannot read page " + std::to_string(page_num) + 
+                             ", " + std::strerror(-bytes_read));
+  }
+  
+  /* whatever was not read is past the end of the file */
+  std::fill(page.begin() + bytes_read, page.end(), 0);
  
-  io_bundles.pages_used[page_id] = true;
-  io_bundles.page_handlers[page_id].init_handler(&io_bundles.get_page(page_id), 
-                                                 layout,
-                                                 page_id, 
-                                                 timestamp_gen++,
-                                                 page_num,
-                                                 fd,
-                                                 PageType::IO);
-  co_return &io_bundles.page_handlers[page_id];
+  Handler* pg_h = init_page(page_id, fd, page_num, layout, true);
+  if (ring) keep_in_ring(*ring, page_id, pg_h);
+  
+  co_return pg_h;
 }
 
 /********************************************************************************/
 
-int32_t DiskManager::lru_replacement(const PageType page_type) {
-  BaseBundle* b_bundle = bundles[page_type];
-  return b_bundle->get_min_page_usage();
+Task<void> DiskManager::read_pages(const int32_t      fd,
+                                   const int32_t      first_page,
+                                   const int32_t      num_pages,
+                                   const RecordLayout layout,
+                                   const IoPriority   priority,
+                                   ScanRing*          ring)
+{
+  std::vector<int32_t> page_ids;
+  std::vector<iovec>   iovecs;
+  
+  int32_t page_num = first_page;
+  while (page_num < first_page + num_pages) {
+    if (bundle_for(fd, page_num).find_page(fd, page_num) != -1) {
+      ++page_num;
+      continue;
+    }
+
+    /* claim a free frame for every page of the run, stop at the first page 
+       that is already in the pool or when we run out of free pages */
+    const int32_t run_start = page_num;
+    for (; page_num < first_page + num_pages &&
+           std::ssize(page_ids) < MAX_READ_RUN && 
+           bundle_for(fd, page_num).find_page(fd, page_num) == -1; ++page_num) 
+    {
+      PageBundle&   bundle  = bundle_for(fd, page_num);
+      const int32_t page_id = ring ? co_await take_ring_frame(*ring, bundle, priority) : 
+                                     co_await claim_or_evict(bundle, priority);
+      if (page_id == -1) break;
+
+      page_ids.push_back(page_id);
+      iovecs.push_back({bundle.get_page(page_id).data(), PAGE_SIZE});
+    }
+
+    /* nothing could be evicted, read_page will wait for room when the pages are asked for */
+    if (page_ids.empty()) co_return;
+
+    const int32_t bytes_read = co_await IoAwaitable{fd,
+                                                    run_start * PAGE_SIZE,
+                                                    iovecs,
+                                                    IOP::Read,
+                                                    priority};
+    
+    /* a short read means the run went past the end of the file */
+    const int32_t pages_read = std::max(bytes_read, 0) / PAGE_SIZE;
+    for (int32_t run_idx = 0; run_idx < std::ssize(page_ids); ++run_idx) {
+      Handler* pg_h = nullptr;
+      
+      if (run_idx < pages_read)
+        pg_h = init_page(page_ids[run_idx], fd, run_start + run_idx, layout, false);
+      
+      /* nullptr if the frame was released, already in the pool or not read */
+      if (ring) keep_in_ring(*ring, page_ids[run_idx], pg_h);
+      if (run_idx >= pages_read) bundle_of(page_ids[run_idx]).release_frame(page_ids[run_idx]);
+    }
+    
+    if (IoAwaitable::is_deadline_error(bytes_read)) 
+      throw DeadlineExceeded{};
+    if (pages_read < std::ssize(page_ids)) co_return;
+    
+    page_ids.clear();
+    iovecs.clear();
+  }
 }
 
 /********************************************************************************/
 
-Task<void> DiskManager::write_page(const int32_t  page_id,
-                                   const int32_t  page_num,
-                                   const PageType page_type) 
+ReadaheadWindow ReadaheadState::next_window(const int32_t page_num,
+                                            const int32_t max_window,
+                                            const int32_t file_pages)
 {
-  BaseBundle* b_bundle = bundles[page_type];
+  if (page_num == last_page) return {};
+  
+  const bool is_sequential = page_num == last_page + 1;
+  last_page = page_num;
 
-  /* no free pages for IO so we have to return one */
-  if (find_first_false(io_bundles.pages_used) == -1) {
-    int32_t replaced_page = lru_replacement(PageType::IO); 
-    co_await return_page(replaced_page, 
-                         PageType::IO);
+  if (!is_sequential) {
+    window    = 0;
+    ahead_end = 0;
+    return {};
   }
 
-  co_await IoAwaitable{b_bundle->get_page_handler(page_id).page_fd,
-                       page_num * PAGE_SIZE,
-                       IOP::Write,
-                       &b_bundle->get_page(page_id)};
+  /* still more than half of the last window ahead of the reader */
+  if (ahead_end - page_num > window / 2) return {};
+
+  window = (window == 0) ? std::min(MIN_READAHEAD, max_window) : 
+                           std::min(2 * window, max_window);
+  
+  /* pages past the ones in use are preallocated zeros, there is nothing to read */
+  const int32_t first_page = std::max(ahead_end, page_num + 1);
+  const int32_t end_page   = std::min(page_num + 1 + window, file_pages);
+  if (first_page >= end_page) return {};
+  
+  ahead_end = end_page;
+  return {first_page, end_page - first_page};
+}
+
+/********************************************************************************/
+
+void DiskManager::read_ahead(const int32_t      fd,
+                             const int32_t      page_num,
+                             const int32_t      file_pages,
+                             const RecordLayout layout)
+{
+  const int32_t max_window = Options::get_instance().readahead_pages;
+  if (max_window == 0) return;
+
+  ReadaheadWindow ahead;
+  {
+    std::lock_guard<std::mutex> lock{readahead_mutex};
+    ReadaheadState& state = readahead_states[fd];
+    
+    ahead = state.next_window(page_num, max_window, file_pages);
+    if (ahead.num_pages == 0) return;
+    
+    ++state.in_flight;
+  }
 
-  b_bundle->get_page_handler(page_id).is_dirty = false;
+  ++num_readaheads;
+  spawn_detached(run_readahead(fd, ahead.first_page, ahead.num_pages, layout));
 }
 
 /********************************************************************************/
 
-Task<void> DiskManager::return_page(const int32_t  page_id,
-                                    const PageType page_type)
+Task<void> DiskManager::run_readahead(const int32_t      fd,
+                                      const int32_t      first_page,
+                                      const int32_t      num_pages,
+                                      const RecordLayout layout)
 {
-  BaseBundle* b_bundle = bundles[page_type];
+  /* a failed readahead only means the reader reads the pages itself */
+  try {
+    co_await read_pages(fd, first_page, num_pages, layout, IoPriority::Background);
+  } catch (const std::exception&) {}
   
-  --b_bundle->get_page_handler(page_id).page_ref;
-  if (b_bundle->get_page_handler(page_id).is_dirty) {
-    co_await write_page(page_id,
-                        b_bundle->get_page_handler(page_id).page_num,
-                        page_type);
+  {
+    std::lock_guard<std::mutex> lock{readahead_mutex};
+    --readahead_states[fd].in_flight;
   }
+  
+  --num_readaheads;
+  num_readaheads.notify_all();
+}
+
+/********************************************************************************/
 
-  if (b_bundle->get_page_handler(page_id).page_ref <= 0) {
-    b_bundle->set_page_used(page_id, false);
+Task<int32_t> DiskManager::flush_file(const int32_t fd) {
+  std::vector<Handler*> dirty_pages;
+  
+  for (int32_t page_id = 0; page_id < get_num_frames(); ++page_id) {
+    PageBundle& bundle = bundle_of(page_id);
+    Handler&    pg_h   = bundle.get_page_handler(page_id);
     
-    if (page_type == PageType::IO)
-      Iouring::get_instance().add_buffer(buff_ring_ptr.get(),
-                                         io_bundles.pages[page_id],
-                                         page_id);
+    /* pinned until written, so they can't be evicted in between */
+    if (pg_h.page_fd == fd && pg_h.is_dirty && 
+        bundle.try_pin_unpinned(page_id, fd, pg_h.page_num))
+      dirty_pages.push_back(&pg_h);
   }
+
+  /* chains before the last one are only writes, the last one ends with the 
+     sync which runs once all writes before it are done */
+  int32_t result = 0;
+  size_t  next   = 0;
+  
+  do {
+    const size_t chain_end = std::min(dirty_pages.size(), next + MAX_LINKED - 1);
+    std::vector<SqeData> chain;
+    
+    for (size_t page = next; page < chain_end; ++page) {
+      Handler* pg_h = dirty_pages[page];
+      pg_h->is_dirty = false;
+      
+      SqeData& write = chain.emplace_back();
+      write.fd        = fd;
+      write.offset    = pg_h->page_num * PAGE_SIZE;
+      write.iop       = IOP::Write;
+      write.page_data = pg_h->page_ptr;
+    }
+    
+    if (chain_end == dirty_pages.size()) {
+      SqeData& sync = chain.emplace_back();
+      sync.fd  = fd;
+      sync.iop = IOP::Fsync;
+    }
+
+    LinkedIoAwaitable linked_io {std::move(chain)};
+    result = co_await linked_io;
+    
+    for (size_t page = next; page < chain_end; ++page) {
+      Handler* pg_h = dirty_pages[page];
+      if (linked_io.chain[page - next].status_code != PAGE_SIZE)
+        pg_h->is_dirty = true;
+      
+      unpin_page(*pg_h);
+    }
+    
+    next = chain_end;
+  } while (result == 0 && next < dirty_pages.size());
+
+  /* a failed chain leaves the pages after it unwritten, still dirty */
+  for (size_t page = next; page < dirty_pages.size(); ++page)
+    unpin_page(*dirty_pages[page]);
+
+  co_return result;
 }
 
 /********************************************************************************/
 
-Handler* DiskManager::get_page(const int32_t  page_id,
-                               const PageType page_type) 
+Task<void> DiskManager::drop_file(const int32_t fd) {
+  /* a readahead still running would read pages of fd back in after they are dropped */
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock{readahead_mutex};
+      const auto state = readahead_states.find(fd);
+      
+      if (state == readahead_states.end() || state->second.in_flight == 0) {
+        if (state != readahead_states.end()) readahead_states.erase(state);
+        break;
+      }
+    }
+    
+    co_await sleep_for(std::chrono::milliseconds{1});
+  }
+
+  for (int32_t page_id = 0; page_id < get_num_frames(); ++page_id) {
+    PageBundle& bundle = bundle_of(page_id);
+    
+    if (bundle.get_page_handler(page_id).page_fd == fd && bundle.unmap_dropped(page_id, fd))
+      bundle.release_frame(page_id);
+  }
+}
+
+/********************************************************************************/
+
+Task<int32_t> DiskManager::acquire_frame(PageBundle& bundle,
+                                         ScanRing*   ring) 
 {
-  BaseBundle* b_bundle = bundles[page_type];
+  while (true) {
+    const uint32_t evictable_seen = bundle.get_evictable_gen();
+    
+    const int32_t page_id = ring ? co_await take_ring_frame(*ring, bundle) : 
+                                   co_await claim_or_evict(bundle);
+    if (page_id != -1) co_return page_id;
+
+    /* -1 when woken because a frame turned evictable, try again */
+    if (const int32_t admitted = co_await PageBundle::FrameAdmission{bundle, evictable_seen};
+        admitted != -1)
+      co_return admitted;
+  }
+}
+
+/********************************************************************************/
+
+void DiskManager::unpin_page(Handler& pg_h) {
+  if (pg_h.unpin()) bundle_of(pg_h.page_id).frame_evictable();
+}
+
+/********************************************************************************/
+
+bool DiskManager::pin_again(Handler&      pg_h,
+                            const int32_t timestamp)
+{
+  PageBundle& bundle = bundle_of(pg_h.page_id);
+  if (!bundle.try_pin(pg_h.page_id, timestamp)) return false;
+
+  bundle.record_access(pg_h.page_id);
+  return true;
+}
+
+/********************************************************************************/
+
+Task<int32_t> DiskManager::claim_or_evict(PageBundle&      bundle,
+                                          const IoPriority priority) 
+{
+  if (const int32_t page_id = bundle.claim_frame();
+      page_id != -1)
+    co_return page_id;
+
+  if (const int32_t victim = bundle.pick_victim();
+      victim != -1)
+  {
+    co_await evict_page(victim, priority);
+  }
+
+  co_return bundle.claim_frame();
+}
+
+/********************************************************************************/
+
+Task<int32_t> DiskManager::take_ring_frame(ScanRing&        ring,
+                                           PageBundle&      bundle,
+                                           const IoPriority priority) 
+{
+  const auto empty_slot = std::ranges::find(ring.frames, NO_FRAME);
+  
+  /* once the ring is full reuse the oldest frame of the bundle that still holds the 
+     page the ring loaded into it, pages of other bundles can't go in its frames */
+  for (size_t step = 0; empty_slot == ring.frames.end() && step < ring.size(); ++step) {
+    const size_t  slot    = (ring.next_slot + step) % ring.size();
+    const int32_t page_id = ring.frames[slot];
+    if (!bundle.owns(page_id)) continue;
+    
+    /* the page the ring loaded, if it is still there and no evictor took the frame */
+    if (bundle.take_tracked(page_id, ring.timestamps[slot]) &&
+        co_await recycle_frame(page_id, priority))
+    {
+      ring.next_slot = (slot + 1) % ring.size();
+      co_return page_id;
+    }
+  }
   
-  if (!b_bundle->get_page_used(page_id)) return nullptr;
+  /* the ring is still filling up or none of its frames could be recycled, then the 
+     frame of the oldest slot is left to the pool and the slot gets the new one */
+  size_t slot = empty_slot - ring.frames.begin();
+  if (empty_slot == ring.frames.end()) {
+    slot           = ring.next_slot;
+    ring.next_slot = (slot + 1) % ring.size();
+  }
+  
+  const int32_t page_id = co_await claim_or_evict(bundle, priority);
+  ring.frames    [slot] = page_id;
+  ring.timestamps[slot] = DEFAULT_TIMESTAMP;
+  co_return page_id;
+}
+
+/********************************************************************************/
 
-  ++b_bundle->get_page_handler(page_id).page_ref;
-  return &b_bundle->get_page_handler(page_id);
+void DiskManager::keep_in_ring(ScanRing&      ring,
+                               const int32_t  page_id,
+                               const Handler* pg_h)
+{
+  const auto slot = std::ranges::find(ring.frames, page_id);
+  if (slot == ring.frames.end()) return;
+
+  if (!pg_h || pg_h->page_id != page_id) {
+    *slot = NO_FRAME;
+    return;
+  }
+  
+  ring.timestamps[slot - ring.frames.begin()] = pg_h->page_timestamp;
+}
+
+/********************************************************************************/
+
+Task<bool> DiskManager::recycle_frame(const int32_t    page_id,
+                                      const IoPriority priority) 
+{
+  PageBundle&   bundle    = bundle_of(page_id);
+  Handler&      pg_h      = bundle.get_page_handler(page_id);
+  const int32_t page_fd   = pg_h.page_fd;
+  const int32_t page_num  = pg_h.page_num;
+  const int32_t timestamp = pg_h.page_timestamp;
+  
+  if (pg_h.is_dirty)
+    co_await write_page(page_id,
+                        page_num,
+                        priority);
+
+  switch (bundle.unmap_unpinned(page_id, page_fd, page_num, timestamp)) {
+    case PageBundle::UnmapResult::Unmapped: co_return true;
+    case PageBundle::UnmapResult::Kept    : bundle.record_load(page_id, true); break;
+    case PageBundle::UnmapResult::Replaced: break;
+  }
+
+  co_return false;
+}
+
+/********************************************************************************/
+
+Task<void> DiskManager::evict_page(const int32_t    page_id,
+                                   const IoPriority priority) 
+{
+  PageBundle&   bundle    = bundle_of(page_id);
+  Handler&      pg_h      = bundle.get_page_handler(page_id);
+  const int32_t page_fd   = pg_h.page_fd;
+  const int32_t page_num  = pg_h.page_num;
+  const int32_t timestamp = pg_h.page_timestamp;
+  
+  if (pg_h.is_dirty)
+    co_await write_page(page_id,
+                        page_num,
+                        priority);
+
+  switch (bundle.unmap_unpinned(page_id, page_fd, page_num, timestamp)) {
+    case PageBundle::UnmapResult::Unmapped: free_frame(page_id); break;
+    case PageBundle::UnmapResult::Kept    : bundle.record_load(page_id, true); break;
+    case PageBundle::UnmapResult::Replaced: break;
+  }
+}
+
+/********************************************************************************/
+
+void DiskManager::free_frame(const int32_t page_id) {
+  PageBundle& bundle = bundle_of(page_id);
+  
+  bundle.forget(page_id);
+  bundle.release_frame(page_id);
+}
+
+/********************************************************************************/
+
+Task<void> DiskManager::write_page(const int32_t    page_id,
+                                   const int32_t    page_num,
+                                   const IoPriority priority) 
+{
+  PageBundle& bundle = bundle_of(page_id);
+  Handler&    pg_h   = bundle.get_page_handler(page_id);
+
+  /* cleared before the write so a change made while it is in flight dirties the page again */
+  pg_h.is_dirty = false;
+
+  /* Foreground when a query waits on the eviction, Background for the flusher and readahead */
+  const int32_t bytes_written = co_await IoAwaitable{pg_h.page_fd,
+                                                     page_num * PAGE_SIZE,
+                                                     IOP::Write,
+                                                     &bundle.get_page(page_id),
+                                                     priority};
+  if (bytes_written != PAGE_SIZE)
+    pg_h.is_dirty = true;
+}
+
+/********************************************************************************/
+
+Handler* DiskManager::get_page(const int32_t page_id,
+                               const int32_t fd,
+                               const int32_t page_num) 
+{
+  PageBundle& bundle = bundle_of(page_id);
+  if (!bundle.try_pin(page_id, fd, page_num)) return nullptr;
+
+  bundle.record_access(page_id);
+  return &bundle.get_page_handler(page_id);
+}
+
+/********************************************************************************/
+
+Handler* DiskManager::init_page(const int32_t      page_id,
+                                const int32_t      fd,
+                                const int32_t      page_num,
+                                const RecordLayout layout,
+                                const bool         is_accessed) 
+{
+  PageBundle& bundle = bundle_of(page_id);
+  Handler&    pg_h   = bundle.init_frame(page_id,
+                                         layout,
+                                         timestamp_gen++,
+                                         page_num,
+                                         fd);
+  
+  /* pinned before it is mapped, nobody can evict it before the caller has it */
+  if (is_accessed) pg_h.pin();
+  
+  /* another read brought the same page in while we were reading it, use theirs, 
+     unless it was evicted again in the meantime, then map ours */
+  for (int32_t mapped_id = bundle.map_page(page_id); 
+       mapped_id != page_id; 
+       mapped_id = bundle.map_page(page_id))
+  {
+    Handler* mapped_pg_h = is_accessed ? get_page(mapped_id, fd, page_num) : nullptr;
+    if (!is_accessed || mapped_pg_h) {
+      if (is_accessed) pg_h.unpin();
+      bundle.release_frame(page_id);
+      return mapped_pg_h;
+    }
+  }
+
+  bundle.record_load(page_id, is_accessed);
+  
+  /* a read ahead page is not pinned, its frame can be evicted from now on */
+  if (!is_accessed) bundle.frame_evictable();
+  return &pg_h;
 }
@@ -0,0 +1,97 @@
+#include "FileOps.hpp"
+
+Task<FileDescriptor> open_async(const std::filesystem::path path,
+                                const OpenMode              open_mode,
+                                const FileUse               file_use)
+{
+  const int32_t flags = FileDescriptor::open_flags(open_mode, file_use);
+  int32_t open_fd     = co_await IoAwaitable{IOP::OpenAt, path.c_str(), flags, 0666};
+
+  /* the filesystem doesn't do direct I/O (tmpfs for one), go through the page cache */
+  if (open_fd == -EINVAL && (flags & O_DIRECT)) {
+    std::cerr << "Warning: O_DIRECT not supported for " << path << "\n";
+    open_fd = co_await IoAwaitable{IOP::OpenAt, path.c_str(), flags & ~O_DIRECT, 0666};
+  }
+
+  if (open_fd < 0)
+    throw std::runtime_error("Error: Cannot open (or create) file:" + path.string() + ", file may not exist");
+
+  co_return FileDescriptor{open_fd, file_use};
+}
+
+/********************************************************************************/
+
+Task<void> close_async(FileDescriptor file) {
+  if (file.fd <= 0) co_return;
+
+  /* out of the fixed file tables first, same as FileDescriptor::close_fd */
+  if (file.is_fixed) Iouring::unregister_file(file.fd);
+  
+  const int32_t close_fd = std::exchange(file.fd, -1);
+  file.is_fixed          = false;
+  
+  if (co_await IoAwaitable{close_fd, 0, IOP::Close} < 0)
+    std::cerr << "Error: Cannot close file\n";
+}
+
+/********************************************************************************/
+
+Task<void> create_file_async(const std::filesystem::path path) {
+  FileDescriptor file {std::move(co_await open_async(path, OpenMode::Create))};
+  co_await close_async(std::move(file));
+}
+
+/********************************************************************************/
+
+/* try the whole path first, the parents usually exist so that is a single MKDIRAT */
+Task<void> create_directories_async(const std::filesystem::path path) {
+  int32_t res = co_await IoAwaitable{IOP::MkdirAt, path.c_str(), 0, 0777};
+  
+  if (res == -ENOENT && path.has_parent_path() && path.parent_path() != path) {
+    co_await create_directories_async(path.parent_path());
+    res = co_await IoAwaitable{IOP::MkdirAt, path.c_str(), 0, 0777};
+  }
+
+  if (res < 0 && res != -EEXIST)
+    throw std::runtime_error("Error: Cannot create directory " + path.string());
+}
+
+/********************************************************************************/
+
+/* io_uring has no getdents, so listing a directory is still a blocking call, 
+   everything else is an UNLINKAT */
+Task<void> remove_all_async(const std::filesystem::path path) {
+  int32_t res = co_await IoAwaitable{IOP::UnlinkAt, path.c_str(), 0};
+  
+  if (res == -EISDIR) {
+    const std::vector<std::filesystem::path> entries {std::filesystem::directory_iterator{path}, 
+                                                      std::filesystem::directory_iterator{}};
+    for (const auto& entry : entries)
+      co_await remove_all_async(entry);
+    
+    res = co_await IoAwaitable{IOP::UnlinkAt, path.c_str(), AT_REMOVEDIR};
+  }
+
+  if (res < 0 && res != -ENOENT)
+    throw std::runtime_error("Error: Cannot remove " + path.string());
+}
+
+/********************************************************************************/
+
+Task<int32_t> preallocate_async(const int32_t fd,
+                                const int32_t num_pages,
+                                const int32_t allocated_pages)
+{
+  const int32_t extent_pages = static_cast<int64_t>(Options::get_instance().extent_mb) * (1 << 20) / PAGE_SIZE;
+  if (num_pages <= allocated_pages || extent_pages == 0) co_return allocated_pages;
+  
+  const int32_t new_allocated = (num_pages + extent_pages - 1) / extent_pages * extent_pages;
+  
+  IoAwaitable fallocate {fd, 
+                         static_cast<off_t>(allocated_pages) * PAGE_SIZE, 
+                         IOP::Fallocate};
+  fallocate.sqe_data.length = static_cast<off_t>(new_allocated - allocated_pages) * PAGE_SIZE;
+  
+  if (co_await fallocate < 0) co_return allocated_pages;
+  co_return new_allocated;
+}
@@ -3,15 +3,19 @@
 IndexManager::IndexManager(std::filesystem::path index_folder_path)
   : parent_index_folder{index_folder_path},
     handler_ptr        {nullptr}
-{ 
-  const auto catalog_path = index_folder_path / "CATALOG_FILE";
+{};
+
+/********************************************************************************/
+
+Task<void> IndexManager::open_catalog() {
+  const auto catalog_path = parent_index_folder / "CATALOG_FILE";
   if (!std::filesystem::exists(catalog_path)) {
-    catalog_file = FileDescriptor{catalog_path, OpenMode::Create};
+    catalog_file = std::move(co_await open_async(catalog_path, OpenMode::Create, FileUse::Paged));
     page_cursor  = IDX_HEADER_SIZE;
     num_index    = 0;
   } else
-    catalog_file = FileDescriptor{catalog_path};
-};
+    catalog_file = std::move(co_await open_async(catalog_path, OpenMode::Default, FileUse::Paged));
+}
 
 /********************************************************************************/
 
@@ -22,7 +26,8 @@ Task<PageResponse> IndexManager::create_index(const std::span<std::string> new_i
   if (co_await find_index(new_index, num_attr) != -1)
     co_return PageResponse::Success;
   
-  PinGuard pin {handler_ptr->is_pinned};
+  co_await pin_catalog();
+  PinGuard pin        {*handler_ptr, std::adopt_lock};
   int32_t  total_size = 0;
 
   for (int32_t i = 0; i < num_attr; ++i)
@@ -47,8 +52,7 @@ Task<PageResponse> IndexManager::create_index(const std::span<std::string> new_i
   page_cursor += sizeof(int32_t);
   catalog_page[page_cursor++] = '\n';
 
-  co_await init_index_folder("INDEX" + std::to_string(num_index),
-                             index_layout);    
+  co_await init_index_folder(num_index, index_layout);    
   ++num_index;
   co_return PageResponse::Success;
 }
@@ -59,7 +63,7 @@ Task<BTree> IndexManager::get_index(std::vector<std::string>& attr_list) {
   const int32_t get_index_id = co_await find_index(attr_list, attr_list.size());
   if (get_index_id == -1) co_return BTree{};
 
-  co_return get_btree(get_index_id);
+  co_return std::move(co_await get_btree(get_index_id));
 }
 
 /********************************************************************************/
@@ -70,7 +74,7 @@ Task<BTree> IndexManager::get_index(const std::span<std::string> attr_list,
   const int32_t get_index_id = co_await find_index(attr_list, num_attr);
   if (get_index_id == -1) co_return BTree{};
 
-  co_return get_btree(get_index_id);
+  co_return std::move(co_await get_btree(get_index_id));
 }
 
 /********************************************************************************/
@@ -78,10 +82,8 @@ Task<BTree> IndexManager::get_index(const std::span<std::string> attr_list,
 Task<int32_t> IndexManager::find_index(const std::span<std::string> attr_list,
                                        const int32_t                num_attr) 
 {
-  if (!handler_ptr || !handler_ptr->is_valid_timestamp(page_timestamp))
-    co_await load_catalog();
-
-  PinGuard pin {handler_ptr->is_pinned};
+  co_await pin_catalog();
+  PinGuard pin {*handler_ptr, std::adopt_lock};
   
   std::string current_line;
   std::string attribute;
@@ -117,10 +119,8 @@ Task<void> IndexManager::update_trees(const TableRecord& table_record,
                                       const RecId        rec_id,
                                       const bool         is_insert)
 {
-  if (!handler_ptr || !handler_ptr->is_valid_timestamp(page_timestamp))
-    co_await load_catalog();
-
-  PinGuard pin {handler_ptr->is_pinned};
+  co_await pin_catalog();
+  PinGuard pin {*handler_ptr, std::adopt_lock};
   
   std::string current_line;
   std::string attribute;
@@ -137,7 +137,7 @@ Task<void> IndexManager::update_trees(const TableRecord& table_record,
       while (std::getline(ss, attribute,','))
         index_attr.push_back(attribute);
 
-      BTree tree {std::move(get_btree(cur_index_id))};
+      BTree tree {std::move(co_await get_btree(cur_index_id))};
       
       if (is_insert)
         co_await tree.insert_entry(table_record.get_subset(index_attr), rec_id);
@@ -152,7 +152,7 @@ Task<void> IndexManager::update_trees(const TableRecord& table_record,
 
 /********************************************************************************/
 
-BTree IndexManager::get_btree(const int32_t index_num) {
+Task<BTree> IndexManager::get_btree(const int32_t index_num) {
   const auto folder_name  = "INDEX" + std::to_string(index_num);
   const auto index_folder = parent_index_folder / folder_name;
 
@@ -162,25 +162,52 @@ BTree IndexManager::get_btree(const int32_t index_num) {
   const auto meta_data_file  = index_folder / "META_DATA";
   const auto index_data_file = index_folder / "INDEX_DATA"; 
 
-  return BTree{IndexMetaData {meta_data_file},
-               FileDescriptor{index_data_file}};
+  auto index_file = index_files.find(index_num);
+  if (index_file == index_files.end())
+    index_file = index_files.emplace(index_num, 
+                                     std::move(co_await open_async(index_data_file, 
+                                                                   OpenMode::Default, 
+                                                                   FileUse::Paged))).first;
+
+  co_return BTree{IndexMetaData {std::move(co_await open_async(meta_data_file, OpenMode::Default))},
+                  index_file->second.fd};
 }
 
 /********************************************************************************/
 
-Task<void> IndexManager::init_index_folder(const std::string   new_index_name,
+Task<void> IndexManager::init_index_folder(const int32_t       index_num,
                                            const RecordLayout& index_layout) 
 {
-  const auto new_index_folder_path = parent_index_folder / new_index_name; 
+  const auto new_index_folder_path = parent_index_folder / ("INDEX" + std::to_string(index_num)); 
   const auto new_meta_data_file    = new_index_folder_path / "META_DATA";
   const auto new_index_data_file   = new_index_folder_path / "INDEX_DATA";
   
-  FileDescriptor{new_meta_data_file, OpenMode::Create};
-  IndexMetaData {index_layout, new_meta_data_file};
+  co_await create_directories_async(new_index_folder_path);
   
-  const auto data_file_fd     = FileDescriptor{new_index_data_file, OpenMode::Create};
-  Handler* index_data_handler = co_await DiskManager::get_instance().create_page(data_file_fd.fd, 
+  IndexMetaData index_meta_data {index_layout, 
+                                 std::move(co_await open_async(new_meta_data_file, OpenMode::Create))};
+  co_await index_meta_data.flush();
+  
+  /* kept open, the root page is only written when it is evicted or flushed */
+  FileDescriptor& data_file = index_files[index_num];
+  data_file = std::move(co_await open_async(new_index_data_file, 
+                                            OpenMode::Create, 
+                                            FileUse::Paged));
+  Handler* index_data_handler = co_await DiskManager::get_instance().create_page(data_file.fd, 
                                                                                  0,
                                                                                  index_layout);
   IndexPageHdr{index_data_handler};
+  DiskManager::get_instance().unpin_page(*index_data_handler);
+}
+
+/********************************************************************************/
+
+Task<void> IndexManager::drop_pages() {
+  DiskManager& disk_manager = DiskManager::get_instance();
+  
+  co_await disk_manager.drop_file(catalog_file.fd);
+  for (const auto& [index_num, index_file] : index_files)
+    co_await disk_manager.drop_file(index_file.fd);
+  
+  handler_ptr = nullptr;
 }
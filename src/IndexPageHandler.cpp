@@ -1,4 +1,5 @@
 #include "IndexPageHandler.hpp"
+#include "DiskManager.hpp"
 #include "IndexMetaData.hpp"
 #include "Iouring.hpp"
 
@@ -11,17 +12,59 @@ IndexPageHandler::IndexPageHandler(Handler* handler,
   meta_data_ptr = index_meta_data;
   timestamp     = handler_ptr->page_timestamp;
   
-  /* we pin a index page for as long as it exists */
-  handler_ptr->is_pinned = true;
+  /* the index page stays pinned for as long as we exist */
   page_hdr.read_header(handler_ptr->page_ptr);
 }
 
 /********************************************************************************/
 
 IndexPageHandler::~IndexPageHandler() {
-  handler_ptr->is_pinned = false;
-  if (handler_ptr->is_dirty)
+  if (!handler_ptr) return;
+  
+  /* dirtied again after the header is written, a write back that cleared the dirty
+     bit meanwhile may have missed it */
+  if (is_modified) {
     page_hdr.write_header(handler_ptr->page_ptr);
+    handler_ptr->is_dirty = true;
+  }
+  DiskManager::get_instance().unpin_page(*handler_ptr);
+}
+
+/********************************************************************************/
+
+IndexPageHandler::IndexPageHandler(const IndexPageHandler& other)
+  : page_hdr     {other.page_hdr},
+    handler_ptr  {other.handler_ptr},
+    meta_data_ptr{other.meta_data_ptr},
+    timestamp    {other.timestamp},
+    key_layout   {other.key_layout},
+    is_modified  {other.is_modified}
+{
+  if (handler_ptr) handler_ptr->pin();
+}
+
+/********************************************************************************/
+
+IndexPageHandler::IndexPageHandler(IndexPageHandler&& other) noexcept
+  : page_hdr     {other.page_hdr},
+    handler_ptr  {std::exchange(other.handler_ptr, nullptr)},
+    meta_data_ptr{other.meta_data_ptr},
+    timestamp    {other.timestamp},
+    key_layout   {std::move(other.key_layout)},
+    is_modified  {other.is_modified}
+{}
+
+/********************************************************************************/
+
+/* other is a copy (or was moved into), swapping hands our old pin to it */
+IndexPageHandler& IndexPageHandler::operator=(IndexPageHandler other) noexcept {
+  std::swap(page_hdr,      other.page_hdr);
+  std::swap(handler_ptr,   other.handler_ptr);
+  std::swap(meta_data_ptr, other.meta_data_ptr);
+  std::swap(timestamp,     other.timestamp);
+  std::swap(key_layout,    other.key_layout);
+  std::swap(is_modified,   other.is_modified);
+  return *this;
 }
 
 /********************************************************************************/
@@ -99,7 +142,7 @@ PageResponse IndexPageHandler::set_key(const int32_t key_idx,
 {
   assert(key_idx < page_hdr.num_keys && key_idx >= 0);
 
-  handler_ptr->is_dirty = true;
+  mark_modified();
   off_t key_offset = key_idx_to_offset(key_idx);     
   return handler_ptr->set_record(key_offset, meta_data_ptr->get_key_layout(), 
                                  new_key_value);
@@ -115,7 +158,7 @@ PageResponse IndexPageHandler::set_keys(const int32_t key_idx,
     if (set_key(idx++, key) != PageResponse::Success)
       return PageResponse::Failure;
   
-  handler_ptr->is_dirty = true;
+  mark_modified();
   return PageResponse::Success;
 }
 
@@ -136,7 +179,7 @@ PageResponse IndexPageHandler::insert_keys(const std::vector<Record>& key_values
 
   assert(shift_resp == PageResponse::Success && 
          set_resp   == PageResponse::Success);
-  handler_ptr->is_dirty = true;
+  mark_modified();
   return PageResponse::Success; 
 }
 
@@ -150,7 +193,7 @@ PageResponse IndexPageHandler::erase_key(const int32_t key_idx) {
       return PageResponse::Failure;
   
   --page_hdr.num_keys;
-  handler_ptr->is_dirty = true;
+  mark_modified();
   return PageResponse::Success;
 }
 
@@ -188,7 +231,7 @@ PageResponse IndexPageHandler::set_rid(const int32_t rid_idx,
   off_t rid_offset = rid_idx_to_offset(rid_idx);     
   write_rid(new_rid_value, rid_offset);
 
-  handler_ptr->is_dirty = true;
+  mark_modified();
   return PageResponse::Success;
 }
 
@@ -203,7 +246,7 @@ PageResponse IndexPageHandler::set_rids(const int32_t rid_idx,
     if (set_rid(idx++, rid) != PageResponse::Success)
       return PageResponse::Failure;
   
-  handler_ptr->is_dirty = true;
+  mark_modified();
   return PageResponse::Success;
 }
 
@@ -222,7 +265,7 @@ PageResponse IndexPageHandler::insert_rids(const std::vector<RecId>& rid_values,
   shift_rids(rid_idx, rid_values.size());
   set_rids(rid_idx, rid_values);
 
-  handler_ptr->is_dirty = true;
+  mark_modified();
   return PageResponse::Success;
 }
 
@@ -236,7 +279,7 @@ PageResponse IndexPageHandler::erase_rid(const int32_t rid_idx) {
       return PageResponse::Failure;
   
   --page_hdr.num_children;
-  handler_ptr->is_dirty = true;
+  mark_modified();
   return PageResponse::Success;
 }
 
@@ -249,7 +292,7 @@ PageResponse IndexPageHandler::shift_keys(const int32_t key_idx,
     if (set_key(idx + shift_size, get_key(idx)) != PageResponse::Success)
       return PageResponse::InvalidRecord;
 
-  handler_ptr->is_dirty = true;
+  mark_modified();
   return PageResponse::Success;
 }
 
@@ -261,6 +304,6 @@ PageResponse IndexPageHandler::shift_rids(const int32_t rid_idx,
   for (int32_t idx = page_hdr.num_children - 1; idx >= rid_idx; --idx)
     set_rid(idx + shift_size, get_rid(idx));
 
-  handler_ptr->is_dirty = true;
+  mark_modified();
   return PageResponse::Success;
 }
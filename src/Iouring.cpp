@@ -83,6 +83,61 @@ size_t Handler::read_from_page(const off_t read_offset,
 /*                              Iouring functions                               */
 /********************************************************************************/
 
+/* sets up the ring using the submission mode picked at startup, if SQPOLL was asked 
+   for but the kernel refuses it (old kernel, no permission to create the polling 
+   thread or bad cpu) we fall back to regular io_uring_enter based submission */
+Iouring::Iouring(const RingOwner ring_owner) 
+  : owner{ring_owner}
+{
+  const Options&  options = Options::get_instance();
+  io_uring_params params;
+
+  if (options.sq_poll) {
+    std::memset(&params, 0, sizeof(params));
+    params.flags          = IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = options.sq_idle_ms;
+
+    if (options.sq_cpu >= 0) {
+      params.flags        |= IORING_SETUP_SQ_AFF;
+      params.sq_thread_cpu = options.sq_cpu;
+    }
+
+    const int32_t err = io_uring_queue_init_params(QUEUE_SIZE, &ring, &params);
+    if (err == 0) {
+      init_wake_fd();
+      init_fixed_files();
+      join_registry();
+      return;
+    }
+
+    std::cerr << "Warning: SQPOLL unavailable (" << std::strerror(-err) 
+              << "), using regular submission\n";
+  }
+
+  std::memset(&params, 0, sizeof(params));
+  if (auto err = io_uring_queue_init_params(QUEUE_SIZE, &ring, &params);
+      err < 0)
+    throw std::runtime_error("Error: initializing io_uring, " + 
+                             std::to_string(err));
+  init_wake_fd();
+  init_fixed_files();
+  join_registry();
+}
+
+/********************************************************************************/
+
+Iouring::~Iouring() {
+  {
+    std::lock_guard<std::mutex> lock{registry_mutex};
+    std::erase(rings, this);
+  }
+
+  io_uring_queue_exit(&ring); 
+  close(wake_fd);
+}
+
+/********************************************************************************/
+
 void Iouring::for_each_cqe(const std::function<void(io_uring_cqe *)>& lambda) {
   io_uring_cqe* cqe  = nullptr;
   uint32_t      head = 0;
@@ -92,6 +147,258 @@ void Iouring::for_each_cqe(const std::function<void(io_uring_cqe *)>& lambda) {
 
 /********************************************************************************/
 
+uint32_t Iouring::reap_completions(std::vector<std::coroutine_handle<>>& ready) {
+  io_uring_cqe* cqe      = nullptr;
+  uint32_t      head     = 0;
+  uint32_t      num_cqes = 0;
+
+  io_uring_for_each_cqe(&ring, head, cqe) {
+    if (const auto coroutine = complete(cqe))
+      ready.push_back(coroutine);
+    ++num_cqes;
+  }
+
+  io_uring_cq_advance(&ring, num_cqes);
+  return num_cqes;
+}
+
+/********************************************************************************/
+
+void Iouring::submit_pending() {
+  auto lock = lock_sq();
+  
+  if (io_uring_sq_ready(&ring) > 0)
+    submit();
+}
+
+/********************************************************************************/
+
+void Iouring::wait_cqe() {
+  io_uring_cqe* cqe = nullptr;
+  
+  /* -EINTR just means a signal came in, the caller loops back to us anyways */
+  if (const int32_t err = io_uring_wait_cqe(&ring, &cqe); 
+      err < 0 && err != -EINTR)
+    throw std::runtime_error("Error: waiting for completions, " + 
+                             std::to_string(err));
+}
+
+/********************************************************************************/
+
+void Iouring::init_wake_fd() {
+  wake_fd = eventfd(0, EFD_CLOEXEC);
+  if (wake_fd == -1)
+    throw std::runtime_error("Error: creating io_uring wake eventfd");
+}
+
+/********************************************************************************/
+
+void Iouring::init_fixed_files() {
+  rlimit file_limit;
+  if (getrlimit(RLIMIT_NOFILE, &file_limit) == 0)
+    num_fixed_files = std::min<rlim_t>(MAX_FIXED_FILES, file_limit.rlim_cur);
+  else
+    num_fixed_files = 0;
+
+  if (num_fixed_files > 0 && 
+      io_uring_register_files_sparse(&ring, num_fixed_files) < 0) 
+  {
+    std::cerr << "Warning: fixed file table unavailable, using plain fds\n";
+    num_fixed_files = 0;
+  }
+
+  fixed_files = std::make_unique<std::atomic<bool>[]>(num_fixed_files);
+}
+
+/********************************************************************************/
+
+void Iouring::join_registry() {
+  std::lock_guard<std::mutex> lock{registry_mutex};
+  rings.push_back(this);
+  
+  for (const int32_t fd : fixed_fds)
+    update_fixed_file(fd, fd);
+
+  if (!fixed_buffers.empty())
+    update_fixed_buffers();
+}
+
+/********************************************************************************/
+
+void Iouring::register_buffers(std::vector<iovec> buffers) {
+  std::lock_guard<std::mutex> lock{registry_mutex};
+  fixed_buffers = std::move(buffers);
+
+  for (Iouring* io_uring : rings)
+    io_uring->update_fixed_buffers();
+}
+
+/********************************************************************************/
+
+void Iouring::update_fixed_buffers() {
+  if (!ring_buffers.empty()) 
+    io_uring_unregister_buffers(&ring);
+  ring_buffers.clear();
+
+  if (const int32_t err = io_uring_register_buffers(&ring, 
+                                                    fixed_buffers.data(), 
+                                                    fixed_buffers.size());
+      err < 0) 
+  {
+    std::cerr << "Warning: could not register fixed buffers (" << std::strerror(-err) 
+              << "), using plain reads and writes\n";
+    return;
+  }
+
+  ring_buffers = fixed_buffers;
+}
+
+/********************************************************************************/
+
+int32_t Iouring::find_fixed_buffer(const Page* page) const {
+  const auto page_addr = reinterpret_cast<uintptr_t>(page->data());
+
+  for (size_t buff_idx = 0; buff_idx < ring_buffers.size(); ++buff_idx) {
+    const auto buff_addr = reinterpret_cast<uintptr_t>(ring_buffers[buff_idx].iov_base);
+    
+    if (page_addr >= buff_addr && 
+        page_addr + PAGE_SIZE <= buff_addr + ring_buffers[buff_idx].iov_len)
+      return buff_idx;
+  }
+
+  return -1;
+}
+
+/********************************************************************************/
+
+void Iouring::register_file(const int32_t fd) {
+  std::lock_guard<std::mutex> lock{registry_mutex};
+  fixed_fds.insert(fd);
+  
+  for (Iouring* io_uring : rings)
+    io_uring->update_fixed_file(fd, fd);
+}
+
+/********************************************************************************/
+
+void Iouring::unregister_file(const int32_t fd) {
+  std::lock_guard<std::mutex> lock{registry_mutex};
+  fixed_fds.erase(fd);
+  
+  for (Iouring* io_uring : rings)
+    io_uring->update_fixed_file(fd, -1);
+}
+
+/********************************************************************************/
+
+/* stop handing out the slot before the file leaves it, and only hand it out 
+   once the kernel has the file in it */
+void Iouring::update_fixed_file(const int32_t slot, 
+                                const int32_t fd) 
+{
+  if (slot < 0 || static_cast<uint32_t>(slot) >= num_fixed_files) 
+    return;
+  
+  int32_t file = fd;
+  fixed_files[slot] = false;
+  
+  if (io_uring_register_files_update(&ring, slot, &file, 1) < 0) {
+    std::cerr << "Warning: could not update fixed file slot " << slot << "\n";
+    return;
+  }
+  
+  fixed_files[slot] = (fd != -1);
+}
+
+/********************************************************************************/
+
+void Iouring::set_fixed_file(io_uring_sqe* sqe, 
+                             const int32_t fd) const 
+{
+  if (fd >= 0 && static_cast<uint32_t>(fd) < num_fixed_files && fixed_files[fd])
+    sqe->flags |= IOSQE_FIXED_FILE;
+}
+
+/********************************************************************************/
+
+void Iouring::arm_wake() {
+  auto lock = lock_sq();
+  io_uring_sqe* sqe = get_sqe();
+
+  io_uring_prep_read(sqe, wake_fd, &wake_value, sizeof(wake_value), 0);
+  io_uring_sqe_set_data(sqe, nullptr);
+}
+
+/********************************************************************************/
+
+void Iouring::wake() {
+  if (!wake_pending.exchange(true))
+    force_wake();
+}
+
+/********************************************************************************/
+
+void Iouring::force_wake() {
+  if (eventfd_write(wake_fd, 1) == -1)
+    std::cerr << "Error: failed to wake io_uring reaper\n";
+}
+
+/********************************************************************************/
+
+io_uring_sqe* Iouring::get_sqe() {
+  io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+  
+  while (!sqe) {
+    submit();
+    sqe = io_uring_get_sqe(&ring);
+  }
+
+  return sqe;
+}
+
+/********************************************************************************/
+
+void Iouring::notify_submit() {
+  /* the owner of a local ring submits before it goes to sleep */
+  if (owner == RingOwner::Local) return;
+
+  if (is_sq_poll()) {
+    std::lock_guard<std::mutex> lock{ring_mutex};
+    submit();
+  } else 
+    wake();
+}
+
+/********************************************************************************/
+
+std::coroutine_handle<> Iouring::complete(io_uring_cqe* cqe) {
+  SqeData* sqe_data = 
+    static_cast<SqeData*>(io_uring_cqe_get_data(cqe));
+  
+  /* our eventfd read completed, someone queued new SQEs */
+  if (!sqe_data) {
+    consume_wake();
+    arm_wake();
+    return nullptr;
+  }
+  
+  /* the read it was linked to reports whether it was cancelled */
+  if (sqe_data == &link_timeout_data) return nullptr;
+   
+  sqe_data->status_code = cqe->res;
+  
+  if (sqe_data->priority == IoPriority::Background && !sqe_data->num_pending)
+    release_background();
+  
+  /* part of a linked chain, only the last request to complete resumes */
+  if (sqe_data->num_pending && --*sqe_data->num_pending > 0)
+    return nullptr;
+  
+  return sqe_data->coroutine;
+}
+
+/********************************************************************************/
+
 uint32_t Iouring::submit_and_wait(const uint32_t wait_nr) {
   const uint32_t result = io_uring_submit_and_wait(&ring, wait_nr);
   
@@ -103,71 +410,204 @@ uint32_t Iouring::submit_and_wait(const uint32_t wait_nr) {
 /********************************************************************************/
 
 void Iouring::read_request(SqeData& sqe_data) {
-  std::lock_guard<std::mutex> lock{ring_mutex};
-  io_uring_sqe* sqe = io_uring_get_sqe(&ring);
-  sqe->buf_group    = BGID;
-  io_uring_prep_read(sqe, 
-                     sqe_data.fd, 
-                     nullptr, 
-                     PAGE_SIZE, 
-                     sqe_data.offset);
-  io_uring_sqe_set_flags(sqe, IOSQE_BUFFER_SELECT);
-  io_uring_sqe_set_data(sqe, &sqe_data);
+  assert(sqe_data.page_data || sqe_data.iovecs);
+  {
+    auto lock = lock_sq();
+    if (!admit_request(sqe_data)) return;
+    queue_request(sqe_data);
+  }
+
+  notify_submit();
 }
 
 /********************************************************************************/
 
 void Iouring::write_request(SqeData& sqe_data) {
-  std::lock_guard<std::mutex> lock{ring_mutex};
-  io_uring_sqe* sqe = io_uring_get_sqe(&ring); 
-  sqe->buf_group    = BGID;
-  io_uring_prep_write(sqe, 
-                      sqe_data.fd, 
-                      sqe_data.page_data->data(), 
-                      sqe_data.page_data->size(), 
-                      sqe_data.offset);
-  io_uring_sqe_set_data(sqe, &sqe_data);
+  assert(sqe_data.page_data || sqe_data.iovecs);
+  {
+    auto lock = lock_sq();
+    if (!admit_request(sqe_data)) return;
+    queue_request(sqe_data);
+  }
+
+  notify_submit();
 }
 
 /********************************************************************************/
 
-void Iouring::register_buffer_ring(io_uring_buf_ring*                 buff_ring,
-                                   std::array<Page, BUFF_RING_SIZE>&  buff_lst)
-{
-  io_uring_buf_reg reg_buf{.ring_addr    = reinterpret_cast<uint64_t>(buff_ring),
-                           .ring_entries = BUFF_RING_SIZE,
-                           .bgid         = BGID};
+void Iouring::file_request(SqeData& sqe_data) {
+  {
+    auto lock = lock_sq();
+    queue_request(sqe_data);
+  }
+
+  notify_submit();
+}
+
+/********************************************************************************/
+
+void Iouring::linked_request(std::span<SqeData> chain) {
+  assert(!chain.empty() && chain.size() <= MAX_LINKED);
+  {
+    auto lock = lock_sq();
+    
+    /* the chain has to reach the kernel in one submit, a chain 
+       split over two submits ends where it was split */
+    while (io_uring_sq_space_left(&ring) < chain.size())
+      submit();
+
+    for (size_t link = 0; link < chain.size(); ++link) {
+      io_uring_sqe* sqe = get_sqe();
+      prep_request(sqe, chain[link]);
+      
+      if (link + 1 < chain.size())
+        sqe->flags |= IOSQE_IO_LINK;
+    }
+  }
 
-  if (io_uring_register_buf_ring(&ring, &reg_buf, 0) != 0)
-    throw std::runtime_error("Error: failed to register buffer ring");
+  notify_submit();
+}
+
+/********************************************************************************/
+
+void Iouring::queue_request(SqeData& sqe_data) {
+  /* the request and its timeout have to reach the kernel in the same submit */
+  while (sqe_data.has_timeout && io_uring_sq_space_left(&ring) < 2)
+    submit();
+
+  io_uring_sqe* sqe = get_sqe();
+  prep_request(sqe, sqe_data);
+  if (!sqe_data.has_timeout) return;
+
+  sqe->flags |= IOSQE_IO_LINK;
+  io_uring_sqe* timeout_sqe = get_sqe();
+  io_uring_prep_link_timeout(timeout_sqe, &sqe_data.timeout, 0);
+  io_uring_sqe_set_data(timeout_sqe, &link_timeout_data);
+}
+
+/********************************************************************************/
+
+bool Iouring::admit_request(SqeData& sqe_data) {
+  if (sqe_data.priority == IoPriority::Foreground) return true;
   
-  /* buffer id is the index into the buffer_lst */
-  io_uring_buf_ring_init(buff_ring);
-  for (uint32_t b_id = 0; b_id < BUFF_RING_SIZE; ++b_id)
-    io_uring_buf_ring_add(buff_ring,
-                          buff_lst[b_id].data(),
-                          buff_lst[b_id].size(), 
-                          b_id,
-                          io_uring_buf_ring_mask(BUFF_RING_SIZE),
-                          b_id);
+  if (num_background >= MAX_BACKGROUND) {
+    deferred_background.push_back(&sqe_data);
+    return false;
+  }
 
-  io_uring_buf_ring_advance(buff_ring, BUFF_RING_SIZE);
+  ++num_background;
+  return true;
 }
 
 /********************************************************************************/
 
-void Iouring::add_buffer(io_uring_buf_ring* buff_ring,
-                         Page&              buff, 
-                         const uint32_t     buff_id)
-{
-  const uint32_t mask = io_uring_buf_ring_mask(BUFF_RING_SIZE);
+/* runs on the thread reaping completions, which submits 
+   the queued request on its next pass */
+void Iouring::release_background() {
+  auto lock = lock_sq();
+  --num_background;
+  
+  if (deferred_background.empty()) return;
+  
+  SqeData* next_request = deferred_background.front();
+  deferred_background.pop_front();
+  
+  ++num_background;
+  queue_request(*next_request);
+}
+
+/********************************************************************************/
+
+static uint16_t to_ioprio(const IoPriority priority) {
+  if (priority == IoPriority::Background)
+    return IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, IOPRIO_BE_NR - 1);
+  return IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, 0);
+}
 
-  io_uring_buf_ring_add(buff_ring, 
-                        buff.data(), 
-                        buff.size(),
-                        buff_id, 
-                        mask,
-                        buff_id);
+/********************************************************************************/
 
-  io_uring_buf_ring_advance(buff_ring, 1);
+void Iouring::prep_request(io_uring_sqe* sqe, 
+                           SqeData&      sqe_data) 
+{
+  switch (sqe_data.iop) {
+    case IOP::Read:
+      if (sqe_data.iovecs) {
+        io_uring_prep_readv(sqe, 
+                            sqe_data.fd, 
+                            sqe_data.iovecs, 
+                            sqe_data.num_iovecs, 
+                            sqe_data.offset);
+      } else if (const int32_t buff_idx = find_fixed_buffer(sqe_data.page_data);
+                 buff_idx != -1) 
+      {
+        io_uring_prep_read_fixed(sqe, 
+                                 sqe_data.fd, 
+                                 sqe_data.page_data->data(), 
+                                 sqe_data.page_data->size(), 
+                                 sqe_data.offset,
+                                 buff_idx);
+      } else {
+        io_uring_prep_read(sqe, 
+                           sqe_data.fd, 
+                           sqe_data.page_data->data(), 
+                           sqe_data.page_data->size(), 
+                           sqe_data.offset);
+      }
+      set_fixed_file(sqe, sqe_data.fd);
+      sqe->ioprio = to_ioprio(sqe_data.priority);
+      break;
+    case IOP::Write:
+      if (sqe_data.iovecs) {
+        io_uring_prep_writev(sqe, 
+                             sqe_data.fd, 
+                             sqe_data.iovecs, 
+                             sqe_data.num_iovecs, 
+                             sqe_data.offset);
+      } else if (const int32_t buff_idx = find_fixed_buffer(sqe_data.page_data);
+                 buff_idx != -1) 
+      {
+        io_uring_prep_write_fixed(sqe, 
+                                  sqe_data.fd, 
+                                  sqe_data.page_data->data(), 
+                                  sqe_data.page_data->size(), 
+                                  sqe_data.offset,
+                                  buff_idx);
+      } else {
+        io_uring_prep_write(sqe, 
+                            sqe_data.fd, 
+                            sqe_data.page_data->data(), 
+                            sqe_data.page_data->size(), 
+                            sqe_data.offset);
+      }
+      set_fixed_file(sqe, sqe_data.fd);
+      sqe->ioprio = to_ioprio(sqe_data.priority);
+      break;
+    case IOP::Fsync:
+      io_uring_prep_fsync(sqe, sqe_data.fd, IORING_FSYNC_DATASYNC);
+      set_fixed_file(sqe, sqe_data.fd);
+      break;
+    case IOP::Fallocate:
+      io_uring_prep_fallocate(sqe, sqe_data.fd, 0, sqe_data.offset, sqe_data.length);
+      set_fixed_file(sqe, sqe_data.fd);
+      break;
+    case IOP::OpenAt:
+      io_uring_prep_openat(sqe, AT_FDCWD, sqe_data.path, sqe_data.flags, sqe_data.mode);
+      break;
+    case IOP::MkdirAt:
+      io_uring_prep_mkdirat(sqe, AT_FDCWD, sqe_data.path, sqe_data.mode);
+      break;
+    case IOP::UnlinkAt:
+      io_uring_prep_unlinkat(sqe, AT_FDCWD, sqe_data.path, sqe_data.flags);
+      break;
+    case IOP::Close:
+      io_uring_prep_close(sqe, sqe_data.fd);
+      break;
+    case IOP::Timeout:
+      io_uring_prep_timeout(sqe, &sqe_data.timeout, 0, 0);
+      break;
+    default: 
+      assert(false && "no operation to prepare");
+  }
+  
+  io_uring_sqe_set_data(sqe, &sqe_data);
 }
@@ -0,0 +1,93 @@
+#include "Options.hpp"
+
+/* all options are of the form --name or --name=value, the flags take no value */
+ParseResult Options::parse(const int argc, char** argv) {
+  for (int32_t arg = 1; arg < argc; ++arg) {
+    const std::string_view option {argv[arg]};
+    const auto             eq_pos = option.find('=');
+
+    const std::string name  {option.substr(0, eq_pos)};
+    const std::string value {eq_pos == std::string_view::npos ? "" : option.substr(eq_pos + 1)};
+    const bool        is_flag = eq_pos == std::string_view::npos;
+
+    try {
+      if (name == "--help" && is_flag) {
+        print_usage(argv[0], std::cout);
+        return ParseResult::ExitOk;
+      }
+      else if (name == "--sqpoll" && is_flag)
+        sq_poll = true;
+      else if (name == "--sqpoll-idle")
+        sq_idle_ms = std::stoul(value);
+      else if (name == "--sqpoll-cpu")
+        sq_cpu = std::stoi(value);
+      else if (name == "--ring-per-thread" && is_flag)
+        ring_per_thread = true;
+      else if (name == "--threads" && std::stoul(value) >= 1)
+        threads = std::stoul(value);
+      else if (name == "--direct-io" && is_flag)
+        direct_io = true;
+      else if (name == "--query-timeout")
+        query_timeout_ms = std::stoul(value);
+      else if (name == "--extent-size" && std::stoul(value) <= MAX_EXTENT_MB)
+        extent_mb = std::stoul(value);
+      else if (name == "--replacer" && (value == "clock" || value == "2q"))
+        replacer = (value == "2q") ? ReplacerType::TwoQ : ReplacerType::Clock;
+      else if (name == "--pool-pages" && std::stoul(value) >= MIN_POOL_PAGES)
+        pool_pages = std::stoul(value);
+      else if (name == "--huge-pages" && is_flag)
+        huge_pages = true;
+      else if (name == "--flush-interval")
+        flush_interval_ms = std::stoul(value);
+      else if (name == "--dirty-age")
+        dirty_age_ms = std::stoul(value);
+      else if (name == "--dirty-ratio" && std::stoul(value) <= 100)
+        dirty_ratio = std::stoul(value);
+      else if (name == "--readahead")
+        readahead_pages = std::stoul(value);
+      else if (name == "--scan-ring")
+        scan_ring_pages = std::stoul(value);
+      else {
+        print_usage(argv[0]);
+        return ParseResult::ExitError;
+      }
+    } catch (const std::logic_error&) {
+      std::cerr << "Error: invalid value for option " << name << "\n";
+      print_usage(argv[0]);
+      return ParseResult::ExitError;
+    }
+  }
+
+  return ParseResult::Run;
+}
+
+/********************************************************************************/
+
+void Options::print_usage(const std::string_view program, std::ostream& out) const {
+  out << "Usage: " << program << " [options]\n"
+      << "  --help               print this and exit\n"
+      << "  --sqpoll             kernel side submission queue polling (IORING_SETUP_SQPOLL)\n"
+      << "  --sqpoll-idle=<ms>   idle time before the polling thread sleeps, default "
+      << sq_idle_ms << "\n"
+      << "  --sqpoll-cpu=<cpu>   cpu to bind the polling thread to\n"
+      << "  --ring-per-thread    every worker thread owns its own io_uring ring\n"
+      << "  --threads=<n>        worker threads running queries, default " << threads << "\n"
+      << "  --direct-io          bypass the OS page cache (O_DIRECT) for table and index data\n"
+      << "  --query-timeout=<ms> cancel SELECTs that run longer than this, default no limit\n"
+      << "  --extent-size=<MiB>  grow table and index files this much at a time, 0 is off, at most "
+      << MAX_EXTENT_MB << ", default " << extent_mb << "\n"
+      << "  --replacer=<policy>  buffer pool eviction policy, clock or 2q, default clock\n"
+      << "  --pool-pages=<n>     buffer pool size in 4 KiB pages, at least " << MIN_POOL_PAGES 
+      << ", default " << pool_pages << "\n"
+      << "  --huge-pages         back the buffer pool with huge pages\n"
+      << "  --flush-interval=<ms> how often dirty pages are written back, 0 is off, default " 
+      << flush_interval_ms << "\n"
+      << "  --dirty-age=<ms>     write back pages dirty for longer than this, default " 
+      << dirty_age_ms << "\n"
+      << "  --dirty-ratio=<%>    write back the oldest dirty pages while more than this percent of "
+      << "the pool is dirty, default " << dirty_ratio << "\n"
+      << "  --readahead=<pages>  most pages read ahead of a sequential reader, 0 is off, default " 
+      << readahead_pages << "\n"
+      << "  --scan-ring=<pages>  frames a table scan recycles instead of using the whole pool, 0 is off, default " 
+      << scan_ring_pages << "\n";
+}
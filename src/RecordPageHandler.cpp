@@ -1,49 +1,94 @@
 #include "RecordPageHandler.hpp"
+#include "DiskManager.hpp"
 
 RecordPageHandler::RecordPageHandler(Handler* handler) 
-  : rw_mutex_ptr       {std::make_unique<std::shared_mutex>()},
-    is_undefined_rec_pg{false}
+  : is_undefined_rec_pg{false}
 {
   assert(handler);
   handler_ptr = handler;
   record_size = calc_record_size(handler_ptr->page_layout); 
-  handler_ptr->is_pinned = true;
   
-  if (handler_ptr->page_type == PageType::NonPersistent) {
-    num_records = 0;
-    page_cursor = REC_HEADER_SIZE;
-  } else {
+  /* created pages are zeroed, so their header says they hold no records */
+  uint32_t version;
+  do {
+    version     = handler_ptr->read_begin();
     num_records = read_header();
-    page_cursor = REC_HEADER_SIZE + record_size * num_records;
-  }
+  } while (!handler_ptr->read_validate(version));
+
+  page_cursor = REC_HEADER_SIZE + record_size * num_records;
 } 
 
 /********************************************************************************/
 
 RecordPageHandler::~RecordPageHandler() {
-  handler_ptr->is_pinned = false;
-  if (handler_ptr->is_dirty) {
-    compact_page();
-    update_num_records();
+  release_page();
+}
+
+/********************************************************************************/
+
+RecordPageHandler::RecordPageHandler(RecordPageHandler&& other) noexcept
+  : is_undefined_rec_pg{other.is_undefined_rec_pg},
+    page_cursor        {other.page_cursor},
+    num_records        {other.num_records},
+    record_size        {other.record_size},
+    handler_ptr        {std::exchange(other.handler_ptr, nullptr)},
+    is_modified        {std::exchange(other.is_modified, false)},
+    tombstones         {std::move(other.tombstones)}
+{}
+
+/********************************************************************************/
+
+RecordPageHandler& RecordPageHandler::operator=(RecordPageHandler&& other) noexcept {
+  if (this == &other) return *this;
+  release_page();
+  
+  is_undefined_rec_pg = other.is_undefined_rec_pg;
+  page_cursor         = other.page_cursor;
+  num_records         = other.num_records;
+  record_size         = other.record_size;
+  handler_ptr         = std::exchange(other.handler_ptr, nullptr);
+  is_modified         = std::exchange(other.is_modified, false);
+  tombstones          = std::move(other.tombstones);
+  return *this;
+}
+
+/********************************************************************************/
+
+/* compacted while still pinned, the page can't be evicted halfway through */
+void RecordPageHandler::release_page() {
+  if (!handler_ptr) return;
+  
+  /* dirtied again once the header is written, a write back that cleared the dirty
+     bit meanwhile may have missed it */
+  if (is_modified) {
+    {
+      PageWriteGuard write_guard{*handler_ptr};
+      compact_page();
+      update_num_records();
+    }
+    handler_ptr->is_dirty = true;
+    is_modified           = false;
   }
+  
+  DiskManager::get_instance().unpin_page(*handler_ptr);
+  handler_ptr = nullptr;
 }
 
 /********************************************************************************/
 
 RecId RecordPageHandler::add_record(Record& record) {
-  std::unique_lock lock{*rw_mutex_ptr};
-
   if (tombstones.empty() && is_full())
     return PAGE_FILLED;
 
-  handler_ptr->is_dirty = true;
+  mark_modified();
   if (!tombstones.empty()) {
     int32_t tomb_idx = *tombstones.rbegin(); 
-    update_record(*tombstones.rbegin(), record);
     tombstones.erase(--std::end(tombstones));
+    update_record(tomb_idx, record);
     return {handler_ptr->page_num, tomb_idx};
   }
 
+  PageWriteGuard write_guard{*handler_ptr};
   handler_ptr->set_record(page_cursor, handler_ptr->page_layout, 
                           record);
 
@@ -54,9 +99,8 @@ RecId RecordPageHandler::add_record(Record& record) {
 
 RecId RecordPageHandler::delete_record(const int32_t record_num) {
   assert(record_num < num_records && record_num >= 0);
-  std::unique_lock lock{*rw_mutex_ptr};
   
-  handler_ptr->is_dirty = true;
+  mark_modified();
   tombstones.insert(record_num);
   return {handler_ptr->page_num, record_num};
 }
@@ -67,7 +111,6 @@ PageResponse RecordPageHandler::update_record(const  int32_t record_num,
                                               Record&        new_record)
 {
   assert(record_num < num_records && record_num >= 0);
-  std::unique_lock lock{*rw_mutex_ptr};
   
   if (tombstones.count(record_num))
     return PageResponse::DeletedRecord;
@@ -77,23 +120,24 @@ PageResponse RecordPageHandler::update_record(const  int32_t record_num,
   if (write_offset > page_cursor)
     return PageResponse::PageFull;
 
+  PageWriteGuard write_guard{*handler_ptr};
   handler_ptr->set_record(write_offset, handler_ptr->page_layout, 
                           new_record);
-  handler_ptr->is_dirty = true;
+  mark_modified();
   return PageResponse::Success;
 }
 
 /********************************************************************************/
 
-/* zero based indexing for record_num, ie: first record is record_num = 0 */
+/* zero based indexing for record_num, ie: first record is record_num = 0. The 
+   record is copied out without a latch and copied again if a writer changed the 
+   page meanwhile, the fields have fixed sizes so a torn copy is only thrown away */
 RecordResponse RecordPageHandler::read_record(const int32_t record_num,
                                               const LockOpt l_opt) 
 {
   assert(record_num < num_records && record_num >= 0);
   Record ret_record;
   
-  if (l_opt == LockOpt::Lock) std::shared_lock lock{*rw_mutex_ptr};
-  
   if (tombstones.count(record_num)) 
     return {std::move(ret_record), PageResponse::DeletedRecord};
 
@@ -104,8 +148,19 @@ RecordResponse RecordPageHandler::read_record(const int32_t record_num,
  
   ret_record.resize(handler_ptr->page_layout.size());
 
-  handler_ptr->get_record(read_offset, handler_ptr->page_layout,
-                          ret_record);
+  if (l_opt == LockOpt::DontLock) {
+    handler_ptr->get_record(read_offset, handler_ptr->page_layout,
+                            ret_record);
+    return {std::move(ret_record), PageResponse::Success};
+  }
+
+  uint32_t version;
+  do {
+    version = handler_ptr->read_begin();
+    handler_ptr->get_record(read_offset, handler_ptr->page_layout,
+                            ret_record);
+  } while (!handler_ptr->read_validate(version));
+  
   return {std::move(ret_record), PageResponse::Success};
 }
 
@@ -114,7 +169,6 @@ RecordResponse RecordPageHandler::read_record(const int32_t record_num,
 void RecordPageHandler::compact_page() {
   if (tombstones.empty()) return;
 
-  std::unique_lock lock{*rw_mutex_ptr};
   size_t num_tombstones = tombstones.size();
 
   /* ineffiecient but I don't mind */
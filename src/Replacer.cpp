@@ -0,0 +1,137 @@
+#include "Replacer.hpp"
+
+std::unique_ptr<Replacer> make_replacer(const size_t num_frames) {
+  if (Options::get_instance().replacer == ReplacerType::TwoQ)
+    return std::make_unique<TwoQReplacer>(num_frames);
+
+  return std::make_unique<ClockReplacer>(num_frames);
+}
+
+/********************************************************************************/
+
+void ClockReplacer::record_load(const int32_t page_id,
+                                const bool    is_accessed)
+{
+  std::lock_guard<std::mutex> lock{replacer_mutex};
+  is_tracked[page_id] = true;
+  ref_bits  [page_id] = is_accessed;
+}
+
+/********************************************************************************/
+
+void ClockReplacer::record_access(const int32_t page_id) {
+  std::lock_guard<std::mutex> lock{replacer_mutex};
+  ref_bits[page_id] = true;
+}
+
+/********************************************************************************/
+
+bool ClockReplacer::remove(const int32_t page_id) {
+  std::lock_guard<std::mutex> lock{replacer_mutex};
+  const bool was_tracked = is_tracked[page_id];
+  
+  is_tracked[page_id] = false;
+  ref_bits  [page_id] = false;
+  return was_tracked;
+}
+
+/********************************************************************************/
+
+/* two full turns of the hand: the first one may only clear reference bits */
+int32_t ClockReplacer::pick_victim(const std::function<bool(const int32_t)>& can_evict) {
+  std::lock_guard<std::mutex> lock{replacer_mutex};
+
+  for (size_t step = 0; step < 2 * is_tracked.size(); ++step) {
+    const int32_t page_id = hand;
+    hand = (hand + 1) % is_tracked.size();
+
+    if (!is_tracked[page_id] || !can_evict(page_id)) continue;
+
+    if (ref_bits[page_id]) {
+      ref_bits[page_id] = false;
+      continue;
+    }
+
+    is_tracked[page_id] = false;
+    return page_id;
+  }
+
+  return NO_FRAME;
+}
+
+/********************************************************************************/
+
+void TwoQReplacer::record_load(const int32_t page_id,
+                               const bool    is_accessed)
+{
+  std::lock_guard<std::mutex> lock{replacer_mutex};
+  unlink(page_id);
+
+  a1_queue.push_front(page_id);
+  frames[page_id] = Frame{Queue::A1, is_accessed, a1_queue.begin()};
+}
+
+/********************************************************************************/
+
+/* the first access of a read ahead page is its first use, it stays on probation */
+void TwoQReplacer::record_access(const int32_t page_id) {
+  std::lock_guard<std::mutex> lock{replacer_mutex};
+  Frame& frame = frames[page_id];
+
+  if (frame.queue == Queue::None) return;
+  if (frame.queue == Queue::A1 && !frame.is_accessed) {
+    frame.is_accessed = true;
+    return;
+  }
+
+  std::list<int32_t>& from = (frame.queue == Queue::A1) ? a1_queue : am_queue;
+  am_queue.splice(am_queue.begin(), from, frame.position);
+  frame.queue = Queue::Am;
+}
+
+/********************************************************************************/
+
+bool TwoQReplacer::remove(const int32_t page_id) {
+  std::lock_guard<std::mutex> lock{replacer_mutex};
+  const bool was_tracked = frames[page_id].queue != Queue::None;
+  
+  unlink(page_id);
+  return was_tracked;
+}
+
+/********************************************************************************/
+
+int32_t TwoQReplacer::pick_victim(const std::function<bool(const int32_t)>& can_evict) {
+  std::lock_guard<std::mutex> lock{replacer_mutex};
+
+  const bool prefer_a1 = a1_queue.size() > a1_target || am_queue.empty();
+
+  int32_t page_id = find_in(prefer_a1 ? a1_queue : am_queue, can_evict);
+  if (page_id == NO_FRAME)
+    page_id = find_in(prefer_a1 ? am_queue : a1_queue, can_evict);
+
+  if (page_id != NO_FRAME) unlink(page_id);
+  return page_id;
+}
+
+/********************************************************************************/
+
+int32_t TwoQReplacer::find_in(const std::list<int32_t>&                 queue,
+                              const std::function<bool(const int32_t)>& can_evict) const
+{
+  for (auto itr = queue.rbegin(); itr != queue.rend(); ++itr)
+    if (can_evict(*itr)) return *itr;
+
+  return NO_FRAME;
+}
+
+/********************************************************************************/
+
+void TwoQReplacer::unlink(const int32_t page_id) {
+  Frame& frame = frames[page_id];
+
+  if (frame.queue == Queue::A1) a1_queue.erase(frame.position);
+  else if (frame.queue == Queue::Am) am_queue.erase(frame.position);
+
+  frame.queue = Queue::None;
+}
@@ -1,5 +1,24 @@
 #include "Table.hpp"
 
+Task<std::unique_ptr<Table>> Table::open(const std::filesystem::path table_data_file,
+                                         const std::filesystem::path table_meta_data_file,
+                                         const std::filesystem::path index_folder)
+{
+  FileDescriptor table_data_fd = std::move(co_await open_async(table_data_file, 
+                                                               OpenMode::Default, 
+                                                               FileUse::Paged));
+  FileDescriptor meta_data_fd  = std::move(co_await open_async(table_meta_data_file, 
+                                                               OpenMode::Default));
+
+  auto table = std::make_unique<Table>(std::move(table_data_fd),
+                                       std::move(meta_data_fd),
+                                       index_folder);
+  co_await table->index_manager.open_catalog();
+  co_return table;
+}
+
+/********************************************************************************/
+
 /********************************************************************************/
 
 Task<std::vector<TableRecord>> Table::execute_command(SQLStatement sql_stmt){
@@ -70,6 +89,7 @@ Task<void> Table::execute_insert(const SQLStatement& sql_stmt)
   RecId rec_id = co_await push_back_record(potential_insert.get_record());
   co_await prim_key_index.insert_entry(key_poten_insert, rec_id);
   co_await index_manager.insert_into_indexes(potential_insert, rec_id);
+  co_await meta_data.flush();
 }
 
 /********************************************************************************/
@@ -105,12 +125,30 @@ Task<std::vector<RecId>> Table::search_table(const SQLStatement& sql_stmt) {
 
 /********************************************************************************/
 
-/* brute force search of table slow, as we have no choice */
+/* brute force search of table slow, as we have no choice. The scan reads through 
+   a ScanRing so it doesn't evict the hot pages of other queries, half a ring of 
+   pages is read at a time so the scan isn't waiting on one 4KiB read after the 
+   other. Without a ring (--scan-ring=0) the DiskManager reads ahead of us instead */
 Task<std::vector<RecId>> Table::find_matches(const SQLStatement& sql_stmt) {
   std::vector<RecId> matches;
   
+  ScanRing      ring     {Options::get_instance().scan_ring_pages};
+  ScanRing*     ring_ptr = ring.size() ? &ring : nullptr;
+  const int32_t run_size = std::max<int32_t>(1, ring.size() / 2);
+  
   for (int32_t page = 0; page < meta_data.get_num_pages(); ++page) {
-    RecordPageHandler rec_page {std::move(co_await get_page(page))};
+    /* cached pages do no I/O, so the deadline is checked here as well */
+    co_await check_deadline();
+    
+    if (ring_ptr && page % run_size == 0)
+      co_await disk_manager.read_pages(table_pages_fd.fd,
+                                       page,
+                                       std::min(run_size, meta_data.get_num_pages() - page),
+                                       meta_data.get_record_layout(),
+                                       IoPriority::Foreground,
+                                       ring_ptr);
+    
+    RecordPageHandler rec_page {std::move(co_await get_page(page, ring_ptr))};
 
     for (int32_t rec_num = 0; rec_num < rec_page.get_num_records(); ++rec_num) {
       const auto [record, response] = rec_page.read_record(rec_num);
@@ -134,7 +172,7 @@ Task<std::vector<RecId>> Table::find_matches(const SQLStatement& sql_stmt,
                                              const int32_t       index_id) 
 {
   std::vector<RecId> matches;
-  BTree index {std::move(index_manager.get_index(index_id))};
+  BTree index {std::move(co_await index_manager.get_index(index_id))};
   
   for (auto rec_id : co_await index.get_matches(equality_key)) {
     RecordPageHandler rec_page {std::move(co_await get_page(rec_id.page_num))};
@@ -205,11 +243,16 @@ std::pair<std::vector<std::string>, Record> Table::get_equality_attr(const SQLSt
 
 /********************************************************************************/
 
-Task<RecordPageHandler> Table::get_page(const int32_t page_num) {
+Task<RecordPageHandler> Table::get_page(const int32_t page_num,
+                                        ScanRing*     ring) 
+{
   assert(page_num < meta_data.get_num_pages());
+  /* pages [0, num_pages] are in use, records are added to page num_pages */
   Handler* handler = co_await disk_manager.read_page(table_pages_fd.fd,
                                                      page_num,
-                                                     meta_data.get_record_layout());
+                                                     meta_data.get_num_pages() + 1,
+                                                     meta_data.get_record_layout(),
+                                                     ring);
   co_return RecordPageHandler{handler};
 }
 
@@ -217,6 +260,15 @@ Task<RecordPageHandler> Table::get_page(const int32_t page_num) {
 
 Task<RecordPageHandler> Table::create_page() {
   meta_data.increase_num_pages();
+  
+  if (const int32_t page_num = meta_data.get_num_pages(); 
+      page_num >= meta_data.get_num_allocated())
+  {
+    meta_data.set_num_allocated(co_await preallocate_async(table_pages_fd.fd,
+                                                           page_num + 1,
+                                                           meta_data.get_num_allocated()));
+  }
+
   Handler* handler = co_await disk_manager.create_page(table_pages_fd.fd,
                                                        meta_data.get_num_pages(),
                                                        meta_data.get_record_layout());
@@ -15,6 +15,16 @@ int32_t calc_record_size(const RecordLayout& layout) {
 
 /********************************************************************************/
 
+void append_bytes(std::vector<uint8_t>& buffer, 
+                  const void*           data, 
+                  const size_t          size) 
+{
+  const auto bytes = static_cast<const uint8_t*>(data);
+  buffer.insert(std::end(buffer), bytes, bytes + size);
+}
+
+/********************************************************************************/
+
 RecordData cast_to(const std::string  attr_value, 
                    const DatabaseType db_type) 
 {
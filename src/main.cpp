@@ -1,7 +1,14 @@
 #include <iostream>
 #include "DatabaseManager.hpp"
+#include "Options.hpp"
+
+int main(int argc, char** argv) {
+  switch (Options::get_instance().parse(argc, argv)) {
+  case ParseResult::ExitOk:    return 0;
+  case ParseResult::ExitError: return 1;
+  case ParseResult::Run:       break;
+  }
 
-int main() {
   DatabaseManager& db_manager = DatabaseManager::get_instance();
   db_manager.start_cmdline();
 }
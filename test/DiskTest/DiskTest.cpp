@@ -1,4 +1,6 @@
 #include <cassert>
+#include <unistd.h>
+
 #include <chrono>
 #include <filesystem>
 #include <iostream>
@@ -10,9 +12,8 @@
 #include "DiskManager.hpp"
 #include "FileDescriptor.hpp"
 #include "Iouring.hpp"
-#include "PageHandler.hpp"
+#include "RecordPageHandler.hpp"
 #include "SyncWaiter.hpp"
-#include "Table.hpp"
 #include "Util.hpp"
 
 
@@ -20,25 +21,23 @@ DiskManager& test_dm     = DiskManager::get_instance();
 RecordLayout test_layout = {Type::Integer, Type::Integer, {Type::String, 52}, Type::Float};
 
 constexpr int32_t NUM_RECORDS = 63;
-constexpr int32_t NUM_PAGES   = 7;
+constexpr int32_t NUM_PAGES   = 10;
+
+/* every test file holds a single page, page 0 */
+constexpr int32_t TEST_PAGE  = 0;
+constexpr int32_t FILE_PAGES = 1;
 
 std::string file_path = "../TestFiles/testpage_";
 std::vector<Record>         test_records;
 std::vector<FileDescriptor> test_pages;
 
-std::atomic<bool> read_no_comp = false;
-std::atomic<bool> till_full    = false;
-std::atomic<bool> del_r1       = false;
-std::atomic<bool> del_r2       = false;
-std::atomic<bool> clear_page   = false;
-
 std::random_device rd;
 std::mt19937 gen(rd());
 
 /********************************************************************************/
 
-int32_t gen_number(int32_t start, 
-                   int32_t end) 
+int32_t gen_number(int32_t start,
+                   int32_t end)
 {
   if (start > end) throw std::runtime_error("Error: gen_number start > end");
 
@@ -50,17 +49,17 @@ std::string gen_name() {
   static const std::string firstNames[] = {"Michael", "Omar", "Jerry", "Terrence", "Ken"};
   static const std::string lastNames[]  = {"Smith", "Doe", "Johnson", "Brown", "Davis"};
 
-  std::uniform_int_distribution<> dist(0, 4); 
+  std::uniform_int_distribution<> dist(0, 4);
   return firstNames[dist(gen)] + " " + lastNames[dist(gen)];
 }
 
 float gen_salary() {
-  std::uniform_real_distribution<> dist(30000.0, 100000.0); 
+  std::uniform_real_distribution<> dist(30000.0, 100000.0);
   return dist(gen);
 }
 
 int32_t gen_id() {
-  std::uniform_int_distribution<> dist(10000, 99999); 
+  std::uniform_int_distribution<> dist(10000, 99999);
   return dist(gen);
 }
 
@@ -74,74 +73,85 @@ void print_record(const Record& record) {
   std::cout << "[";
   for (const auto& data : record)
   std::visit([](const auto& arg) {
-               std::cout << arg << ", ";            
+               std::cout << arg << ", ";
              }, data);
   std::cout << "]\n";
 }
 
-void print_page(PageHandler* pg_h) {
-  for (int32_t i = 0; i < pg_h->get_num_records(); ++i) {
-    auto [rec, stat] = pg_h->read_record(i);
+void print_page(RecordPageHandler& rec_page) {
+  for (int32_t i = 0; i < rec_page.get_num_records(); ++i) {
+    auto [rec, stat] = rec_page.read_record(i);
     if (stat == PageResponse::Success)
       print_record(rec);
   }
 }
 
-bool records_equal(const Record& r1, 
+bool records_equal(const Record& r1,
                    const Record& r2)
 {
   return (r1.size() == r2.size() && r1 == r2);
 }
 
+/* the handlers the DiskManager hands out come pinned, RecordPageHandler takes
+   the pin over and drops it when it goes out of scope */
+RecordPageHandler create_test_page(FileDescriptor& file) {
+  return RecordPageHandler{sync_wait(test_dm.create_page(file.fd,
+                                                         TEST_PAGE,
+                                                         test_layout))};
+}
+
+RecordPageHandler read_test_page(FileDescriptor& file) {
+  return RecordPageHandler{sync_wait(test_dm.read_page(file.fd,
+                                                       TEST_PAGE,
+                                                       FILE_PAGES,
+                                                       test_layout))};
+}
+
 /********************************************************************************/
 
-bool test_create_page_write_single_record(Record& record, 
-                                          FileDescriptor& create_file) 
+bool test_create_page_write_single_record(Record& record,
+                                          FileDescriptor& create_file)
 {
-  PageHandler* pg_h = sync_wait(test_dm.create_page(create_file.fd,
-                                                    test_layout)); 
-  
-  pg_h->add_record(record); 
-  auto [rec, resp]  = pg_h->read_record(0);
+  RecordPageHandler rec_page = create_test_page(create_file);
+
+  const RecId rec_id = rec_page.add_record(record);
+  assert(rec_id == RecId(TEST_PAGE, 0));
 
-  sync_wait(test_dm.return_page(pg_h->get_page_id(), pg_h->get_page_type()));
+  auto [rec, resp] = rec_page.read_record(0);
+  assert(resp == PageResponse::Success);
   assert(records_equal(record, rec));
-  
+
   return true;
 }
 
 /********************************************************************************/
 
 bool test_create_page_write_many_records(FileDescriptor& create_file,
-                                         size_t num_records) 
+                                         size_t num_records)
 {
-  PageHandler* pg_h = sync_wait(test_dm.create_page(create_file.fd, 
-                                                    test_layout)); 
-  
-  for (int32_t i = 0; i < num_records; ++i)
-    if (pg_h->add_record(test_records[i]) != 
-      PageResponse::Success)
+  RecordPageHandler rec_page = create_test_page(create_file);
+
+  for (size_t i = 0; i < num_records; ++i)
+    if (rec_page.add_record(test_records[i]) == PAGE_FILLED)
       break;
 
-  assert(pg_h->get_num_records() == num_records);
+  assert(rec_page.get_num_records() == static_cast<int32_t>(num_records));
 
-  for (int32_t i = 0; i < pg_h->get_num_records(); ++i) {
-    auto [rec, _] = pg_h->read_record(i);
+  for (int32_t i = 0; i < rec_page.get_num_records(); ++i) {
+    auto [rec, _] = rec_page.read_record(i);
     assert(records_equal(rec, test_records[i]));
   }
 
-  sync_wait(test_dm.return_page(pg_h->get_page_id(), pg_h->get_page_type()));
   return true;
 }
 
 /********************************************************************************/
 
 bool test_read_existing_page(FileDescriptor& read_file) {
-  PageHandler* pg_h = sync_wait(test_dm.read_page(read_file.fd, 
-                                                  test_layout)); 
-  
-  for (int32_t i = 0; i < pg_h->get_num_records(); ++i) {
-    auto [rec, _] = pg_h->read_record(i);
+  RecordPageHandler rec_page = read_test_page(read_file);
+
+  for (int32_t i = 0; i < rec_page.get_num_records(); ++i) {
+    auto [rec, _] = rec_page.read_record(i);
     assert(records_equal(rec, test_records[i]));
   }
 
@@ -150,118 +160,242 @@ bool test_read_existing_page(FileDescriptor& read_file) {
 
 /********************************************************************************/
 
-bool test_read_page_no_comparison(FileDescriptor& read_file) {
-  PageHandler* pg_h = sync_wait(test_dm.read_page(read_file.fd, 
-                                                  test_layout)); 
-  read_no_comp = true;
-  
-  if (!clear_page)
-    assert(pg_h->get_num_records() > 0);
+bool test_add_til_page_full(FileDescriptor& create_file) {
+  RecordPageHandler rec_page = create_test_page(create_file);
 
-  for (int32_t i = 0; i < pg_h->get_num_records(); ++i) {
-    auto [rec, status] = pg_h->read_record(i);
-    assert(status != PageResponse::PageFull);
+  for (int i = 0; i < NUM_RECORDS; ++i) {
+    if (rec_page.add_record(test_records[i]) == PAGE_FILLED ||
+        !records_equal(test_records[i], rec_page.read_record(i).record))
+      assert(false);
   }
 
-  return true;
+  assert(rec_page.is_full());
+  return rec_page.add_record(test_records[0]) == PAGE_FILLED;
 }
 
 /********************************************************************************/
 
-bool test_add_til_page_full(FileDescriptor& create_file) {
-  PageHandler* pg_h = sync_wait(test_dm.create_page(create_file.fd, 
-                                                    test_layout));
-  for (int i = 0; i < NUM_RECORDS; ++i) {
-    if (pg_h->add_record(test_records[i]) != PageResponse::Success ||
-        !records_equal(test_records[i], pg_h->read_record(i).record)) 
-      assert(false);
+/* deleted records read as DeletedRecord until the page is released, then it is
+   compacted: the records that are left keep their order */
+bool test_read_page_delete_random_records_and_compact(FileDescriptor& file,
+                                                      size_t num_del)
+{
+  std::unordered_set<int32_t> removed_records;
+  int32_t num_records;
+
+  {
+    RecordPageHandler rec_page = read_test_page(file);
+    num_records = rec_page.get_num_records();
+
+    assert(num_records > 0);
+    assert(num_del <= static_cast<size_t>(num_records));
+
+    while (removed_records.size() < num_del) {
+      const int32_t rand_record = gen_number(0, num_records - 1);
+      if (rec_page.read_record(rand_record).status == PageResponse::DeletedRecord)
+        continue;
+
+      const int32_t rec_id = std::get<int32_t>(rec_page.read_record(rand_record).record[0]);
+      rec_page.delete_record(rand_record);
+      removed_records.insert(rec_id);
+
+      assert(rec_page.read_record(rand_record).status == PageResponse::DeletedRecord);
+    }
   }
 
-  PageResponse resp = pg_h->add_record(test_records[0]);
-  sync_wait(test_dm.return_page(pg_h->get_page_id(), pg_h->get_page_type()));
+  RecordPageHandler rec_page = read_test_page(file);
+  assert(rec_page.get_num_records() == num_records - std::ssize(removed_records));
+
+  int32_t last_id = -1;
+  for (int32_t i = 0; i < rec_page.get_num_records(); ++i) {
+    const int32_t rec_id = std::get<int32_t>(rec_page.read_record(i).record[0]);
 
-  till_full = true;
-  return resp == PageResponse::PageFull;
+    assert(!removed_records.contains(rec_id));
+    assert(rec_id > last_id);
+    last_id = rec_id;
+  }
+
+  return true;
 }
 
 /********************************************************************************/
 
-bool test_read_page_delete_random_records_and_compact(FileDescriptor& file, 
-                                                      size_t num_del,
-                                                      std::atomic<bool>* flag = nullptr) 
+/* a record added after a delete takes the deleted records slot */
+bool test_read_page_delete_record_add_record(FileDescriptor& read_file,
+                                             int32_t record_num)
 {
-  PageHandler* pg_h = sync_wait(test_dm.read_page(file.fd,
-                                                  test_layout));
-   
-  std::unordered_set<int32_t> removed_records;
-  int32_t num_records = pg_h->get_num_records();
+  RecordPageHandler rec_page = read_test_page(read_file);
 
-  assert(num_records > 0);
+  const int32_t old_num_records = rec_page.get_num_records();
+  rec_page.delete_record(record_num);
 
-  for (int32_t _ = 0, rand_record; _ < num_del; ++_) {
-    rand_record = gen_number(0, pg_h->get_num_records() - 1);
-    
-    Record  del_rec = pg_h->read_record(rand_record).record;
-    int32_t rec_id  = std::get<int32_t>(del_rec[0]);
+  const RecId rec_id = rec_page.add_record(test_records[0]);
+  assert(rec_id == RecId(TEST_PAGE, record_num));
+  assert(rec_page.get_num_records() == old_num_records);
 
-    PageResponse del_resp = pg_h->delete_record(rand_record);
-    removed_records.insert(rec_id);
-    
-    if (del_resp != PageResponse::Success)
-      break;
+  return records_equal(rec_page.read_record(record_num).record, test_records[0]);
+}
+
+/********************************************************************************/
+
+bool test_clear_page(FileDescriptor& read_file) {
+  {
+    RecordPageHandler rec_page = read_test_page(read_file);
+    for (int32_t rec = 0; rec < rec_page.get_num_records(); ++rec)
+      rec_page.delete_record(rec);
+  }
+
+  RecordPageHandler rec_page = read_test_page(read_file);
+  assert(rec_page.get_num_records() == 0);
+  return true;
+}
+
+/********************************************************************************/
 
-    PageResponse pg_resp = pg_h->read_record(rec_id).status;
-    assert(pg_resp == PageResponse::DeletedRecord);
+/* every read of a page pins it once more, the frame can only be evicted once every
+   reader unpinned it */
+bool test_pin_counting(FileDescriptor& file) {
+  RecordPageHandler created = create_test_page(file);
+
+  Handler* first  = sync_wait(test_dm.read_page(file.fd, TEST_PAGE, FILE_PAGES, test_layout));
+  Handler* second = sync_wait(test_dm.read_page(file.fd, TEST_PAGE, FILE_PAGES, test_layout));
+
+  assert(first == second);
+  assert(first->pin_count == 3);
+
+  test_dm.unpin_page(*first);
+  test_dm.unpin_page(*second);
+  assert(first->pin_count == 1);
+
+  {
+    PinGuard pin_guard{*first};
+    assert(first->pin_count == 2);
   }
 
-  if (flag) *flag = true;
+  assert(first->pin_count == 1);
+  return true;
+}
+
+/********************************************************************************/
+
+/* a handler kept from an earlier read is only pinned again while its frame still
+   holds the page it was read with */
+bool test_pin_again(FileDescriptor& file) {
+  Handler* pg_h = sync_wait(test_dm.read_page(file.fd, TEST_PAGE, FILE_PAGES, test_layout));
+
+  const int32_t timestamp = pg_h->page_timestamp;
+  test_dm.unpin_page(*pg_h);
+  assert(!pg_h->is_pinned());
+
+  assert(test_dm.pin_again(*pg_h, timestamp));
+  PinGuard pin_guard{*pg_h, std::adopt_lock};
+  assert(pg_h->pin_count == 1);
+
+  assert(!test_dm.pin_again(*pg_h, timestamp + 1));
+  assert(pg_h->pin_count == 1);
   return true;
 }
 
 /********************************************************************************/
 
-bool test_read_page_delete_record_add_record(FileDescriptor& read_file, 
-                                             int32_t record_num) 
+/* the record count in the header of the page as it is on disk */
+int32_t num_records_on_disk(FileDescriptor& file) {
+  int32_t num_records = 0;
+  if (pread(file.fd, &num_records, sizeof(num_records), TEST_PAGE * PAGE_SIZE) == -1)
+    throw std::runtime_error("Error: Cannot read test page header");
+
+  return num_records;
+}
+
+/* a page pinned by a handler that is changing it is left alone by flush_file, the 
+   header is written once the handler is released and the file is flushed again */
+bool test_flush_file_open_handler(FileDescriptor& file,
+                                  size_t num_records) 
 {
-  PageHandler* pg_h = sync_wait(test_dm.read_page(read_file.fd, 
-                                                  test_layout)); 
-  
-  int32_t old_num_records = pg_h->get_num_records();
-  pg_h->delete_record(record_num);
+  {
+    RecordPageHandler rec_page = create_test_page(file);
+    for (size_t i = 0; i < num_records; ++i)
+      assert(rec_page.add_record(test_records[i]) != PAGE_FILLED);
 
-  pg_h->add_record(test_records[0]);
-  int32_t last_record = pg_h->get_num_records() - 1;
-  bool test_return = 
-    records_equal(pg_h->read_record(last_record).record, test_records[0]);
-  
-  assert(test_return);
+    assert(sync_wait(test_dm.flush_file(file.fd)) == 0);
+    assert(num_records_on_disk(file) == 0);
+  }
+
+  assert(sync_wait(test_dm.flush_file(file.fd)) == 0);
+  assert(num_records_on_disk(file) == static_cast<int32_t>(num_records));
 
-  sync_wait(test_dm.return_page(pg_h->get_page_id(), pg_h->get_page_type()));
-  return test_return;
+  RecordPageHandler rec_page = read_test_page(file);
+  assert(rec_page.get_num_records() == static_cast<int32_t>(num_records));
+  return true;
 }
 
 /********************************************************************************/
 
-bool test_clear_page(FileDescriptor& read_file) {
-  PageHandler* pg_h = sync_wait(test_dm.read_page(read_file.fd, 
-                                                  test_layout)); 
-  int32_t num_records = pg_h->get_num_records();
-  
-  for (int32_t rec = 0; pg_h->delete_record(0) != PageResponse::PageEmpty; ++rec);
-  clear_page = true;
+bool windows_equal(const ReadaheadWindow& window,
+                   const int32_t          first_page,
+                   const int32_t          num_pages)
+{
+  return window.first_page == first_page && window.num_pages == num_pages;
+}
 
-  assert(pg_h->get_num_records() == 0);
-  sync_wait(test_dm.return_page(pg_h->get_page_id(), pg_h->get_page_type())); 
+/* a sequential reader gets a window of MIN_READAHEAD pages, the next one once it is 
+   halfway into it, twice as large. A read that isn't sequential starts over */
+bool test_readahead_window() {
+  constexpr int32_t max_window = 16;
+  constexpr int32_t file_pages = 100;
+  ReadaheadState state;
+
+  assert(windows_equal(state.next_window(0, max_window, file_pages), 1, MIN_READAHEAD));
+  assert(state.next_window(0, max_window, file_pages).num_pages == 0);
+  assert(state.next_window(1, max_window, file_pages).num_pages == 0);
+  assert(state.next_window(2, max_window, file_pages).num_pages == 0);
+  /* the window of 8 pages is counted from page 4, pages 4 to 11, page 4 was read 
+     ahead already */
+  assert(windows_equal(state.next_window(3, max_window, file_pages), 5, 2 * MIN_READAHEAD - 1));
+
+  assert(state.next_window(50, max_window, file_pages).num_pages == 0);
+  assert(windows_equal(state.next_window(51, max_window, file_pages), 52, MIN_READAHEAD));
+
+  /* the window grows to max_window and stops there, from then on every readahead
+     short of the end of the file ends max_window pages past the reader */
+  int32_t full_windows = 0;
+  for (int32_t page_num = 52; page_num < file_pages; ++page_num) {
+    const ReadaheadWindow window = state.next_window(page_num, max_window, file_pages);
+    assert(window.num_pages <= max_window);
+    assert(state.window     <= max_window);
+
+    if (window.num_pages > 0 && state.window == max_window &&
+        page_num + 1 + max_window <= file_pages) {
+      assert(window.first_page + window.num_pages == page_num + 1 + max_window);
+      ++full_windows;
+    }
+  }
+
+  assert(state.window == max_window);
+  assert(full_windows > 1);
+  
   return true;
 }
 
 /********************************************************************************/
 
-Task<TablePage> test_table_page(const std::string page_path) {
-  FileDescriptor page_file{page_path};
-  PageHandler* pg_h = co_await test_dm.read_page(page_file.fd, 
-                                                 test_layout);
-  co_return TablePage{pg_h, pg_h->get_timestamp()};
+/* pages past the ones the file uses are never read ahead */
+bool test_readahead_window_file_end() {
+  constexpr int32_t max_window = 16;
+  constexpr int32_t file_pages = 3;
+  ReadaheadState state;
+
+  assert(windows_equal(state.next_window(0, max_window, file_pages), 1, 2));
+  assert(state.next_window(1, max_window, file_pages).num_pages == 0);
+  assert(state.next_window(2, max_window, file_pages).num_pages == 0);
+  assert(state.next_window(3, max_window, file_pages).num_pages == 0);
+
+  for (int32_t page_num = 4; page_num < 100; ++page_num) {
+    const ReadaheadWindow window = state.next_window(page_num, max_window, file_pages);
+    assert(window.num_pages == 0 || window.first_page + window.num_pages <= file_pages);
+  }
+
+  return true;
 }
 
 /********************************************************************************/
@@ -269,11 +403,13 @@ enum TestPages {
   CreatePage = 0,
   CreateWriteManyPage,
   AddTillFullPage,
-  FillAndDeletePage
+  FillAndDeletePage,
+  PinPage,
+  FlushPage
 };
 
 enum TestPagesMT {
-  CreatePageMT = 4,
+  CreatePageMT = 6,
   CreateWriteManyPageMT,
   AddTillFullPageMT,
   FillAndDeletePageMT
@@ -282,7 +418,7 @@ enum TestPagesMT {
 const int32_t num_record_to_add      = 20;
 const int32_t record_num             = 10;
 const int32_t first_round_deletions  = 20;
-const int32_t second_round_deletions = 25; 
+const int32_t second_round_deletions = 25;
 
 /********************************************************************************/
 
@@ -290,17 +426,17 @@ void sync_test() {
   std::cout << "\nSync Tests:\n";
 
   std::cout << "*******************************************\n";
-  std::cout << "TEST: test_create_page_write_single_record(test_records[0], test_pages[0])\n"; 
-  assert(test_create_page_write_single_record(test_records[0], 
+  std::cout << "TEST: test_create_page_write_single_record(test_records[0], test_pages[0])\n";
+  assert(test_create_page_write_single_record(test_records[0],
                                               test_pages[TestPages::CreatePage]));
 
   std::cout << "*******************************************\n";
-  std::cout << "TEST: test_create_page_write_many_records(test_pages[1], 20)\n"; 
+  std::cout << "TEST: test_create_page_write_many_records(test_pages[1], 20)\n";
   assert(test_create_page_write_many_records(test_pages[TestPages::CreateWriteManyPage],
                                              num_record_to_add));
 
   std::cout << "*******************************************\n";
-  std::cout << "TEST: test_read_existing_page(test_pages[1])\n"; 
+  std::cout << "TEST: test_read_existing_page(test_pages[1])\n";
   assert(test_read_existing_page(test_pages[TestPages::CreateWriteManyPage]));
 
   std::cout << "*******************************************\n";
@@ -309,85 +445,101 @@ void sync_test() {
 
   std::cout << "*******************************************\n";
   std::cout << "TEST: test_read_page_delete_random_records_and_compact(test_pages[2], first_round_deletions)\n";
-  assert(test_read_page_delete_random_records_and_compact(test_pages[TestPages::AddTillFullPage], 
+  assert(test_read_page_delete_random_records_and_compact(test_pages[TestPages::AddTillFullPage],
                                                           first_round_deletions));
-  
+
   std::cout << "*******************************************\n";
   std::cout << "TEST: test_read_page_delete_random_records_and_compact(test_pages[2], second_round_deletions)\n";
-  assert(test_read_page_delete_random_records_and_compact(test_pages[TestPages::AddTillFullPage], 
+  assert(test_read_page_delete_random_records_and_compact(test_pages[TestPages::AddTillFullPage],
                                                           second_round_deletions));
 
-
   std::cout << "*******************************************\n";
   std::cout << "TEST: test_read_page_delete_record_add_record(test_pages[2], 10)\n";
-  assert(test_read_page_delete_record_add_record(test_pages[TestPages::AddTillFullPage], 
-                                                 record_num)); 
+  assert(test_read_page_delete_record_add_record(test_pages[TestPages::AddTillFullPage],
+                                                 record_num));
 
   std::cout << "*******************************************\n";
   std::cout << "TEST: test_add_til_full(test_pages[3])\n";
   assert(test_add_til_page_full(test_pages[TestPages::FillAndDeletePage]));
   std::cout << "TEST: test_clear_page(test_pages[3])\n";
   assert(test_clear_page(test_pages[TestPages::FillAndDeletePage]));
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_pin_counting(test_pages[4])\n";
+  assert(test_pin_counting(test_pages[TestPages::PinPage]));
+  std::cout << "TEST: test_pin_again(test_pages[4])\n";
+  assert(test_pin_again(test_pages[TestPages::PinPage]));
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_flush_file_open_handler(test_pages[5], 20)\n";
+  assert(test_flush_file_open_handler(test_pages[TestPages::FlushPage],
+                                      num_record_to_add));
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_readahead_window()\n";
+  assert(test_readahead_window());
+  std::cout << "TEST: test_readahead_window_file_end()\n";
+  assert(test_readahead_window_file_end());
 }
 
 /********************************************************************************/
 
 void multithreaded_test() {
   std::cout << "\nMultithreaded Test (No prints, they are confusing):\n";
- 
+
   auto t1 = std::jthread{[]() {
-    assert(test_create_page_write_single_record(test_records[0], 
+    assert(test_create_page_write_single_record(test_records[0],
                                                 test_pages[TestPagesMT::CreatePageMT]));
   }};
-  
+
   auto t2 = std::jthread{[] {
-    assert(test_create_page_write_many_records(test_pages[TestPagesMT::CreateWriteManyPageMT], 
+    assert(test_create_page_write_many_records(test_pages[TestPagesMT::CreateWriteManyPageMT],
                                                num_record_to_add));
-    
+
     assert(test_read_existing_page(test_pages[TestPagesMT::CreateWriteManyPageMT]));
   }};
-  
+
   auto t3 = std::jthread{[]() {
     assert(test_add_til_page_full(test_pages[TestPagesMT::AddTillFullPageMT]));
-    
-    assert(test_read_page_delete_random_records_and_compact(test_pages[TestPagesMT::AddTillFullPageMT], 
-                                                            first_round_deletions,
-                                                            &del_r1)); 
-    
-    assert(test_read_page_delete_random_records_and_compact(test_pages[TestPagesMT::AddTillFullPageMT], 
-                                                            second_round_deletions,
-                                                            &del_r2));
-    
-    assert(test_read_page_delete_record_add_record(test_pages[TestPagesMT::AddTillFullPageMT], 
-                                                   record_num)); 
-     
+
+    assert(test_read_page_delete_random_records_and_compact(test_pages[TestPagesMT::AddTillFullPageMT],
+                                                            first_round_deletions));
+
+    assert(test_read_page_delete_random_records_and_compact(test_pages[TestPagesMT::AddTillFullPageMT],
+                                                            second_round_deletions));
+
+    assert(test_read_page_delete_record_add_record(test_pages[TestPagesMT::AddTillFullPageMT],
+                                                   record_num));
+
     assert(test_clear_page(test_pages[TestPagesMT::AddTillFullPageMT]));
   }};
-  
-  
+
+  /* readers of pages the sync tests wrote, while the other threads load theirs */
   auto t4 = std::jthread{[] {
-    std::this_thread::sleep_for(std::chrono::milliseconds(3));
-    assert(test_read_page_no_comparison(test_pages[TestPagesMT::AddTillFullPageMT]));
-    assert(test_read_existing_page(test_pages[TestPagesMT::CreatePageMT]));
-    assert(test_read_existing_page(test_pages[TestPagesMT::CreateWriteManyPageMT]));
+    assert(test_add_til_page_full(test_pages[TestPagesMT::FillAndDeletePageMT]));
+
+    for (int32_t round = 0; round < 100; ++round) {
+      assert(test_read_existing_page(test_pages[TestPages::CreateWriteManyPage]));
+      assert(test_read_existing_page(test_pages[TestPagesMT::FillAndDeletePageMT]));
+    }
   }};
 }
 
 /********************************************************************************/
 
 int main() {
+  std::filesystem::create_directories("../TestFiles");
+
   for (int32_t i = 0; i < NUM_PAGES; ++i)
-    test_pages.emplace_back(file_path + std::to_string(i), 
-                            OpenMode::Create);
+    test_pages.emplace_back(file_path + std::to_string(i),
+                            OpenMode::Create,
+                            FileUse::Paged);
 
   for (int32_t i = 0; i < NUM_RECORDS; ++i)
     test_records.push_back(gen_random_record(i));
 
   sync_test();
   multithreaded_test();
- 
-  TablePage t_pg = sync_wait(test_table_page(file_path + "0"));
-  std::cout << "TIMESTAMP: " << t_pg.pg_timestamp << "\n";
+
   std::cout << "\nAll Tests Passed!\n";
 }
-
@@ -0,0 +1,115 @@
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <random>
+#include <utility>
+
+#include "PageTable.hpp"
+
+constexpr int32_t NUM_FRAMES = 64;
+constexpr int32_t NUM_FILES  = 3;
+constexpr int32_t NUM_ROUNDS = 20000;
+
+std::mt19937 gen(42);
+
+/********************************************************************************/
+
+bool test_insert_find() {
+  PageTable page_table {NUM_FRAMES};
+
+  for (int32_t page = 0; page < NUM_FRAMES; ++page)
+    assert(page_table.insert(3, page, page) == page);
+
+  for (int32_t page = 0; page < NUM_FRAMES; ++page)
+    assert(page_table.find(3, page) == page);
+
+  /* same page number of another file, and a page never inserted */
+  assert(page_table.find(4, 0)          == NO_FRAME);
+  assert(page_table.find(3, NUM_FRAMES) == NO_FRAME);
+  return true;
+}
+
+/********************************************************************************/
+
+/* a page loaded twice at the same time keeps the frame it was mapped to first */
+bool test_insert_existing() {
+  PageTable page_table {NUM_FRAMES};
+
+  assert(page_table.insert(3, 7, 1) == 1);
+  assert(page_table.insert(3, 7, 2) == 1);
+  assert(page_table.find(3, 7) == 1);
+  return true;
+}
+
+/********************************************************************************/
+
+bool test_erase_other_frame() {
+  PageTable page_table {NUM_FRAMES};
+
+  page_table.insert(3, 7, 1);
+  page_table.erase (3, 7, 2);
+  assert(page_table.find(3, 7) == 1);
+
+  page_table.erase(3, 7, 1);
+  assert(page_table.find(3, 7) == NO_FRAME);
+
+  /* erasing what isn't there changes nothing */
+  page_table.erase(3, 7, 1);
+  assert(page_table.find(3, 7) == NO_FRAME);
+  return true;
+}
+
+/********************************************************************************/
+
+/* Every page that was not erased has to stay reachable after the entries behind an
+   erased one are shifted back. A small table of consecutive pages of a few files
+   has long probe runs that wrap around the end of the slots, the table is checked
+   against a std::map after every insert and erase */
+bool test_backward_shift_erase() {
+  PageTable page_table {NUM_FRAMES};
+  std::map<std::pair<int32_t, int32_t>, int32_t> mapped;
+
+  std::uniform_int_distribution<int32_t> file_dist(1, NUM_FILES);
+  std::uniform_int_distribution<int32_t> page_dist(0, NUM_FRAMES);
+
+  for (int32_t round = 0; round < NUM_ROUNDS; ++round) {
+    const auto page = std::make_pair(file_dist(gen), page_dist(gen));
+
+    if (const auto entry = mapped.find(page); entry != mapped.end()) {
+      page_table.erase(page.first, page.second, entry->second);
+      mapped.erase(entry);
+      assert(page_table.find(page.first, page.second) == NO_FRAME);
+    } else if (std::ssize(mapped) < NUM_FRAMES) {
+      const int32_t page_id = round % NUM_FRAMES;
+      assert(page_table.insert(page.first, page.second, page_id) == page_id);
+      mapped[page] = page_id;
+    }
+
+    for (const auto& [mapped_page, page_id] : mapped)
+      assert(page_table.find(mapped_page.first, mapped_page.second) == page_id);
+  }
+
+  return true;
+}
+
+/********************************************************************************/
+
+int main() {
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_insert_find()\n";
+  assert(test_insert_find());
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_insert_existing()\n";
+  assert(test_insert_existing());
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_erase_other_frame()\n";
+  assert(test_erase_other_frame());
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_backward_shift_erase()\n";
+  assert(test_backward_shift_erase());
+
+  std::cout << "\nAll Tests Passed!\n";
+}
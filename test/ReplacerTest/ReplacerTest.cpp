@@ -0,0 +1,165 @@
+#include <cassert>
+#include <iostream>
+
+#include "Replacer.hpp"
+
+constexpr int32_t NUM_FRAMES = 8;
+
+const auto any_frame = [](const int32_t) { return true; };
+
+/********************************************************************************/
+
+/* every frame was asked for, the first turn of the hand only clears reference bits,
+   the frame after the victim has its bit set again and is passed over */
+bool test_clock_second_chance() {
+  ClockReplacer replacer {NUM_FRAMES};
+
+  for (int32_t frame = 0; frame < 4; ++frame)
+    replacer.record_load(frame, true);
+
+  assert(replacer.pick_victim(any_frame) == 0);
+
+  replacer.record_access(1);
+  assert(replacer.pick_victim(any_frame) == 2);
+  assert(replacer.pick_victim(any_frame) == 3);
+  assert(replacer.pick_victim(any_frame) == 1);
+  assert(replacer.pick_victim(any_frame) == NO_FRAME);
+  return true;
+}
+
+/********************************************************************************/
+
+/* a read ahead page nobody asked for has no reference bit, it goes first */
+bool test_clock_read_ahead() {
+  ClockReplacer replacer {NUM_FRAMES};
+
+  replacer.record_load(0, true);
+  replacer.record_load(1, false);
+
+  assert(replacer.pick_victim(any_frame) == 1);
+  return true;
+}
+
+/********************************************************************************/
+
+bool test_clock_can_evict_remove() {
+  ClockReplacer replacer {NUM_FRAMES};
+
+  replacer.record_load(0, false);
+  replacer.record_load(1, false);
+  replacer.record_load(2, false);
+
+  /* pinned frames are skipped */
+  assert(replacer.pick_victim([](const int32_t frame) { return frame != 0; }) == 1);
+
+  assert( replacer.remove(2));
+  assert(!replacer.remove(2));
+  assert(!replacer.remove(1)); /* given out as a victim already */
+
+  assert(replacer.pick_victim([](const int32_t frame) { return frame != 0; }) == NO_FRAME);
+  assert(replacer.pick_victim(any_frame) == 0);
+  return true;
+}
+
+/********************************************************************************/
+
+/* NUM_FRAMES = 8 leaves a1 a target of 2 frames. Pages asked for once stay on
+   probation in a1 and are evicted oldest first while a1 is over its target, the
+   pages asked for again were promoted to am and outlast the scan */
+bool test_2q_scan_resistance() {
+  TwoQReplacer replacer {NUM_FRAMES};
+
+  replacer.record_load(0, true);
+  replacer.record_load(1, true);
+  replacer.record_access(0);
+  replacer.record_access(1);
+
+  /* a scan */
+  for (int32_t frame = 2; frame < NUM_FRAMES; ++frame)
+    replacer.record_load(frame, true);
+
+  for (int32_t frame = 2; frame < 6; ++frame)
+    assert(replacer.pick_victim(any_frame) == frame);
+
+  /* a1 is down to its target, am gives up its least recently used page */
+  replacer.record_access(0);
+  assert(replacer.pick_victim(any_frame) == 1);
+  assert(replacer.pick_victim(any_frame) == 0);
+  assert(replacer.pick_victim(any_frame) == 6);
+  assert(replacer.pick_victim(any_frame) == 7);
+  assert(replacer.pick_victim(any_frame) == NO_FRAME);
+  return true;
+}
+
+/********************************************************************************/
+
+/* the first access of a read ahead page is its first use, only the second one
+   promotes it */
+bool test_2q_promotion() {
+  TwoQReplacer replacer {NUM_FRAMES};
+
+  replacer.record_load(0, false);
+  replacer.record_load(1, false);
+  replacer.record_load(2, false);
+  replacer.record_load(3, true);
+
+  replacer.record_access(0);
+  replacer.record_access(1);
+  replacer.record_access(1);
+
+  /* a1 holds 3 2 0 (newest first) over its target, am holds 1 */
+  assert(replacer.pick_victim(any_frame) == 0);
+  assert(replacer.pick_victim(any_frame) == 1);
+  assert(replacer.pick_victim(any_frame) == 2);
+  assert(replacer.pick_victim(any_frame) == 3);
+  return true;
+}
+
+/********************************************************************************/
+
+bool test_2q_can_evict_remove() {
+  TwoQReplacer replacer {NUM_FRAMES};
+
+  replacer.record_load(0, true);
+  replacer.record_load(1, true);
+  replacer.record_access(1);
+
+  /* nothing evictable in the queue it prefers (am), the other one is used */
+  assert(replacer.pick_victim([](const int32_t frame) { return frame != 1; }) == 0);
+
+  assert(!replacer.remove(0));
+  assert( replacer.remove(1));
+  assert(!replacer.remove(1));
+  assert(replacer.pick_victim(any_frame) == NO_FRAME);
+  return true;
+}
+
+/********************************************************************************/
+
+int main() {
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_clock_second_chance()\n";
+  assert(test_clock_second_chance());
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_clock_read_ahead()\n";
+  assert(test_clock_read_ahead());
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_clock_can_evict_remove()\n";
+  assert(test_clock_can_evict_remove());
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_2q_scan_resistance()\n";
+  assert(test_2q_scan_resistance());
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_2q_promotion()\n";
+  assert(test_2q_promotion());
+
+  std::cout << "*******************************************\n";
+  std::cout << "TEST: test_2q_can_evict_remove()\n";
+  assert(test_2q_can_evict_remove());
+
+  std::cout << "\nAll Tests Passed!\n";
+}